@@ -0,0 +1,127 @@
+#include "api_cache.h"
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <unistd.h>
+#include "log.h"
+
+static constexpr char kApiCacheMagic[] = "il2cpp-api-cache";
+
+bool ApiCache::load(const char *path) {
+    auto fp = fopen(path, "re");
+    if (!fp) {
+        return false;
+    }
+    names.clear();
+    offsets.clear();
+    char *line = nullptr;
+    size_t capacity = 0;
+    ssize_t length;
+    auto ok = true;
+    auto line_no = 0;
+    while (ok && (length = getline(&line, &capacity, fp)) > 0) {
+        if (line[length - 1] == '\n') {
+            line[length - 1] = '\0';
+        }
+        switch (line_no++) {
+            case 0: {
+                char magic[32];
+                int version = 0;
+                ok = sscanf(line, "%31s %d", magic, &version) == 2 && strcmp(magic, kApiCacheMagic) == 0 &&
+                     version == kVersion;
+                break;
+            }
+            case 1: {
+                char id[129];
+                ok = sscanf(line, "build_id %128s", id) == 1;
+                build_id = id;
+                break;
+            }
+            default: {
+                uint64_t offset = 0;
+                int name_offset = 0;
+                ok = sscanf(line, "%" SCNx64 " %n", &offset, &name_offset) == 1 && name_offset > 0 &&
+                     line[name_offset] != '\0';
+                if (ok) {
+                    offsets.push_back(offset);
+                    names.emplace_back(line + name_offset);
+                }
+                break;
+            }
+        }
+    }
+    free(line);
+    fclose(fp);
+    if (!ok || line_no < 2) {
+        LOGW("ignoring invalid api cache %s", path);
+        names.clear();
+        offsets.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ApiCache::save(const char *path) const {
+    auto tmp_path = std::string(path).append(".tmp");
+    auto fp = fopen(tmp_path.c_str(), "we");
+    if (!fp) {
+        LOGE("open %s failed: %s", tmp_path.c_str(), strerror(errno));
+        return false;
+    }
+    fprintf(fp, "%s %d\n", kApiCacheMagic, kVersion);
+    fprintf(fp, "build_id %s\n", build_id.c_str());
+    for (size_t i = 0; i < names.size(); ++i) {
+        fprintf(fp, "%" PRIx64 " %s\n", offsets[i], names[i].c_str());
+    }
+    auto ok = !ferror(fp);
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(tmp_path.c_str(), path) != 0) {
+        LOGE("write %s failed: %s", path, strerror(errno));
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string read_build_id(uintptr_t load_bias, const ElfW(Phdr) *phdr, size_t phnum) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    for (size_t i = 0; i < phnum; ++i) {
+        if (phdr[i].p_type != PT_NOTE) {
+            continue;
+        }
+        auto note = reinterpret_cast<const uint8_t *>(load_bias + phdr[i].p_vaddr);
+        auto end = note + phdr[i].p_memsz;
+        while (note + sizeof(ElfW(Nhdr)) <= end) {
+            auto nhdr = reinterpret_cast<const ElfW(Nhdr) *>(note);
+            auto name = note + sizeof(ElfW(Nhdr));
+            auto desc = name + ((nhdr->n_namesz + 3) & ~3u);
+            if (desc + nhdr->n_descsz > end) {
+                break;
+            }
+            if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 && memcmp(name, "GNU", 4) == 0 &&
+                nhdr->n_descsz > 0 && nhdr->n_descsz <= 64) {
+                std::string id;
+                for (uint32_t j = 0; j < nhdr->n_descsz; ++j) {
+                    id.push_back(kHex[desc[j] >> 4]);
+                    id.push_back(kHex[desc[j] & 0xf]);
+                }
+                return id;
+            }
+            note = desc + ((nhdr->n_descsz + 3) & ~3u);
+        }
+    }
+    return {};
+}
+
+bool is_code_offset(const ElfW(Phdr) *phdr, size_t phnum, uint64_t offset) {
+    for (size_t i = 0; i < phnum; ++i) {
+        if (phdr[i].p_type == PT_LOAD && (phdr[i].p_flags & PF_X) && offset >= phdr[i].p_vaddr &&
+            offset < phdr[i].p_vaddr + phdr[i].p_memsz) {
+            return true;
+        }
+    }
+    return false;
+}
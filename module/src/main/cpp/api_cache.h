@@ -0,0 +1,34 @@
+#ifndef ZYGISK_IL2CPPDUMPER_API_CACHE_H
+#define ZYGISK_IL2CPPDUMPER_API_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <link.h>
+#include <string>
+#include <vector>
+
+// Where every il2cpp api was found in one build of libil2cpp.so, as offsets from its load bias,
+// so the next launch of the same build binds without looking up a single symbol.
+struct ApiCache {
+    // bump whenever the file format changes
+    static constexpr int kVersion = 1;
+
+    // hex NT_GNU_BUILD_ID of the build the offsets belong to
+    std::string build_id;
+    // api names in DO_API order, with 0 as the offset of every api that was not found
+    std::vector<std::string> names;
+    std::vector<uint64_t> offsets;
+
+    bool load(const char *path);
+
+    // written to a temporary file and renamed into place
+    bool save(const char *path) const;
+};
+
+// hex NT_GNU_BUILD_ID from the PT_NOTE segments of a loaded library, empty when it has none
+std::string read_build_id(uintptr_t load_bias, const ElfW(Phdr) *phdr, size_t phnum);
+
+// whether `offset` lies in an executable PT_LOAD segment of the library
+bool is_code_offset(const ElfW(Phdr) *phdr, size_t phnum, uint64_t offset);
+
+#endif //ZYGISK_IL2CPPDUMPER_API_CACHE_H
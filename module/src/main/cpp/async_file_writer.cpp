@@ -0,0 +1,185 @@
+#include "async_file_writer.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "log.h"
+
+static constexpr size_t kBufferAlignment = 4096;
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+AsyncFileWriter::AsyncFileWriter(bool sync, size_t buffer_size, int buffer_count)
+        : sync(sync), buffer_size(buffer_size), buffers(std::max(buffer_count, 2)), used(buffers.size()) {
+    for (auto &buffer: buffers) {
+        void *memory = nullptr;
+        if (posix_memalign(&memory, kBufferAlignment, buffer_size) != 0) {
+            abort();
+        }
+        buffer = static_cast<char *>(memory);
+    }
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    close();
+    for (auto buffer: buffers) {
+        free(buffer);
+    }
+}
+
+bool AsyncFileWriter::open(const char *path) {
+    close();
+    fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOGE("open %s failed: %s", path, strerror(errno));
+        return false;
+    }
+    ready.clear();
+    idle.clear();
+    for (int i = (int) buffers.size() - 1; i >= 0; --i) {
+        idle.push_back(i);
+    }
+    current = -1;
+    finishing = false;
+    error = false;
+    total = 0;
+    blocked_ns = 0;
+    busy_ns = 0;
+    write_calls = 0;
+    writer = std::thread(&AsyncFileWriter::writer_loop, this);
+    return true;
+}
+
+void AsyncFileWriter::take_buffer() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (idle.empty()) {
+        // every buffer is queued for the disk, the only time rendering waits for storage
+        auto begin = now_ns();
+        buffer_free.wait(lock, [this] { return !idle.empty(); });
+        blocked_ns += now_ns() - begin;
+    }
+    current = idle.back();
+    idle.pop_back();
+    used[current] = 0;
+}
+
+void AsyncFileWriter::submit_buffer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(current);
+    }
+    current = -1;
+    buffer_ready.notify_one();
+}
+
+void AsyncFileWriter::write(const char *data, size_t size) {
+    if (fd < 0) {
+        return;
+    }
+    total += size;
+    while (size > 0) {
+        if (current < 0) {
+            take_buffer();
+        }
+        auto n = std::min(size, buffer_size - used[current]);
+        memcpy(buffers[current] + used[current], data, n);
+        used[current] += n;
+        data += n;
+        size -= n;
+        if (used[current] == buffer_size) {
+            submit_buffer();
+        }
+    }
+}
+
+bool AsyncFileWriter::write_buffers(const std::vector<int> &batch) {
+    std::vector<iovec> iov;
+    iov.reserve(batch.size());
+    for (auto index: batch) {
+        iov.push_back({buffers[index], used[index]});
+    }
+    auto begin = now_ns();
+    size_t first = 0;
+    while (first < iov.size()) {
+        auto n = ::writev(fd, iov.data() + first, (int) (iov.size() - first));
+        ++write_calls;
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOGE("write failed: %s", strerror(errno));
+            return false;
+        }
+        // skip what the kernel took, it may stop in the middle of a buffer
+        auto written = (size_t) n;
+        while (first < iov.size() && written >= iov[first].iov_len) {
+            written -= iov[first].iov_len;
+            ++first;
+        }
+        if (first < iov.size()) {
+            iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + written;
+            iov[first].iov_len -= written;
+        }
+    }
+    busy_ns += now_ns() - begin;
+    return true;
+}
+
+void AsyncFileWriter::writer_loop() {
+    std::vector<int> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            buffer_ready.wait(lock, [this] { return finishing || !ready.empty(); });
+            if (ready.empty()) {
+                break;
+            }
+            batch.assign(ready.begin(), ready.end());
+            ready.clear();
+        }
+        // after an error keep recycling buffers so write() never waits forever
+        if (!error && !write_buffers(batch)) {
+            error = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle.insert(idle.end(), batch.begin(), batch.end());
+        }
+        buffer_free.notify_one();
+    }
+}
+
+bool AsyncFileWriter::close() {
+    if (fd < 0) {
+        return !error;
+    }
+    if (current >= 0 && used[current] > 0) {
+        submit_buffer();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finishing = true;
+    }
+    buffer_ready.notify_one();
+    writer.join();
+    if (sync && !error && fdatasync(fd) != 0) {
+        LOGE("fdatasync failed: %s", strerror(errno));
+        error = true;
+    }
+    if (::close(fd) != 0) {
+        LOGE("close failed: %s", strerror(errno));
+        error = true;
+    }
+    fd = -1;
+    current = -1;
+    LOGI("writer: %zu bytes in %zu writes, disk busy %.1f ms, producer blocked %.1f ms", total, write_calls,
+         (double) busy_ns / 1e6, (double) blocked_ns / 1e6);
+    return !error;
+}
@@ -0,0 +1,81 @@
+#ifndef ZYGISK_IL2CPPDUMPER_ASYNC_FILE_WRITER_H
+#define ZYGISK_IL2CPPDUMPER_ASYNC_FILE_WRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "dump_sink.h"
+
+// File sink with its own I/O thread. write() fills one of several page-aligned buffers;
+// full buffers are handed to the writer thread, which drains everything that is ready
+// with one writev() call. The producer only blocks when every buffer is waiting for the
+// disk, and that time is reported on close().
+class AsyncFileWriter : public DumpSink {
+public:
+    static constexpr size_t kDefaultBufferSize = 2 << 20;
+    static constexpr int kDefaultBufferCount = 3;
+
+    // `sync` runs fdatasync once everything has been written
+    explicit AsyncFileWriter(bool sync = false, size_t buffer_size = kDefaultBufferSize,
+                             int buffer_count = kDefaultBufferCount);
+
+    ~AsyncFileWriter() override;
+
+    AsyncFileWriter(const AsyncFileWriter &) = delete;
+
+    AsyncFileWriter &operator=(const AsyncFileWriter &) = delete;
+
+    bool open(const char *path) override;
+
+    void write(const char *data, size_t size) override;
+
+    using DumpSink::write;
+
+    bool close() override;
+
+    bool failed() const override {
+        return error;
+    }
+
+    size_t size() const override {
+        return total;
+    }
+
+private:
+    void take_buffer();
+
+    void submit_buffer();
+
+    void writer_loop();
+
+    bool write_buffers(const std::vector<int> &batch);
+
+    bool sync;
+    size_t buffer_size;
+    std::vector<char *> buffers;
+    std::vector<size_t> used;
+    int fd = -1;
+
+    // buffer write() is filling, -1 when none
+    int current = -1;
+    std::mutex mutex;
+    std::condition_variable buffer_ready;
+    std::condition_variable buffer_free;
+    std::deque<int> ready;
+    std::vector<int> idle;
+    bool finishing = false;
+    std::thread writer;
+    std::atomic<bool> error{false};
+
+    size_t total = 0;
+    uint64_t blocked_ns = 0;
+    // writer thread only until it is joined
+    uint64_t busy_ns = 0;
+    size_t write_calls = 0;
+};
+
+#endif //ZYGISK_IL2CPPDUMPER_ASYNC_FILE_WRITER_H
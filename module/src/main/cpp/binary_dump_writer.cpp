@@ -0,0 +1,218 @@
+#include "binary_dump_writer.h"
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "log.h"
+
+static constexpr size_t kSectionBufferSize = 256 * 1024;
+
+void BinaryDumpChunk::clear() {
+    strings.clear();
+    types.clear();
+    extends.clear();
+    fields.clear();
+    properties.clear();
+    methods.clear();
+    params.clear();
+}
+
+void BinaryDumpChunk::swap(BinaryDumpChunk &other) {
+    strings.swap(other.strings);
+    types.swap(other.types);
+    extends.swap(other.extends);
+    fields.swap(other.fields);
+    properties.swap(other.properties);
+    methods.swap(other.methods);
+    params.swap(other.params);
+}
+
+std::string BinaryDumpWriter::section_path(int id) const {
+    return path + "." + std::to_string(id) + ".tmp";
+}
+
+BinaryDumpWriter::~BinaryDumpWriter() {
+    remove_sections();
+}
+
+void BinaryDumpWriter::remove_sections() {
+    for (int i = 0; i < BINARY_DUMP_SECTION_COUNT; ++i) {
+        if (sections[i]) {
+            sections[i].reset();
+            unlink(section_path(i).c_str());
+        }
+    }
+}
+
+bool BinaryDumpWriter::open(const char *file) {
+    remove_sections();
+    path = file;
+    for (int i = 0; i < BINARY_DUMP_SECTION_COUNT; ++i) {
+        sections[i] = std::make_unique<BufferedWriter>(kSectionBufferSize);
+        if (!sections[i]->open(section_path(i).c_str())) {
+            sections[i].reset();
+            remove_sections();
+            return false;
+        }
+        counts[i] = 0;
+    }
+    next_type = 0;
+    // offset 0 is the empty string
+    write(BINARY_DUMP_STRINGS, "", 1, 1);
+    interned[std::string_view()] = 0;
+    return true;
+}
+
+void BinaryDumpWriter::write(BinaryDumpSectionId id, const void *data, size_t count, size_t size) {
+    sections[id]->write(static_cast<const char *>(data), count * size);
+    counts[id] += id == BINARY_DUMP_STRINGS ? count * size : count;
+}
+
+uint32_t BinaryDumpWriter::intern(std::string_view str) {
+    if (!str.data()) {
+        return kBinaryDumpNoString;
+    }
+    bool inserted;
+    auto &id = interned_pointers.find_or_insert(str.data(), inserted);
+    if (!inserted) {
+        return id;
+    }
+    auto it = interned.find(str);
+    if (it != interned.end()) {
+        id = it->second;
+        return id;
+    }
+    id = (uint32_t) counts[BINARY_DUMP_STRINGS];
+    interned.emplace(str, id);
+    write(BINARY_DUMP_STRINGS, str.data(), str.size(), 1);
+    write(BINARY_DUMP_STRINGS, "", 1, 1);
+    return id;
+}
+
+void BinaryDumpWriter::add_image(const char *name, uint32_t type_count, uint32_t flags) {
+    BinaryDumpImage image{};
+    image.name = intern(name ? std::string_view(name) : std::string_view());
+    image.type_begin = next_type;
+    image.type_count = type_count;
+    image.flags = flags;
+    next_type += type_count;
+    write(BINARY_DUMP_IMAGES, &image, 1, sizeof(image));
+}
+
+void BinaryDumpWriter::add_chunk(const BinaryDumpChunk &chunk) {
+    remap.resize(chunk.strings.size());
+    for (size_t i = 0; i < chunk.strings.size(); ++i) {
+        remap[i] = intern(chunk.strings[i]);
+    }
+    auto string = [this](uint32_t id) {
+        return id == kBinaryDumpNoString ? id : remap[id];
+    };
+    auto extends_base = (uint32_t) counts[BINARY_DUMP_EXTENDS];
+    auto field_base = (uint32_t) counts[BINARY_DUMP_FIELDS];
+    auto property_base = (uint32_t) counts[BINARY_DUMP_PROPERTIES];
+    auto method_base = (uint32_t) counts[BINARY_DUMP_METHODS];
+    auto param_base = (uint32_t) counts[BINARY_DUMP_PARAMS];
+    for (auto type: chunk.types) {
+        type.namespaze = string(type.namespaze);
+        type.name = string(type.name);
+        type.extends_begin += extends_base;
+        type.field_begin += field_base;
+        type.property_begin += property_base;
+        type.method_begin += method_base;
+        write(BINARY_DUMP_TYPES, &type, 1, sizeof(type));
+    }
+    for (auto extends: chunk.extends) {
+        extends = string(extends);
+        write(BINARY_DUMP_EXTENDS, &extends, 1, sizeof(extends));
+    }
+    for (auto field: chunk.fields) {
+        field.name = string(field.name);
+        field.type = string(field.type);
+        write(BINARY_DUMP_FIELDS, &field, 1, sizeof(field));
+    }
+    for (auto property: chunk.properties) {
+        property.name = string(property.name);
+        property.type = string(property.type);
+        write(BINARY_DUMP_PROPERTIES, &property, 1, sizeof(property));
+    }
+    for (auto method: chunk.methods) {
+        method.name = string(method.name);
+        method.return_type = string(method.return_type);
+        method.param_begin += param_base;
+        write(BINARY_DUMP_METHODS, &method, 1, sizeof(method));
+    }
+    for (auto param: chunk.params) {
+        param.name = string(param.name);
+        param.type = string(param.type);
+        write(BINARY_DUMP_PARAMS, &param, 1, sizeof(param));
+    }
+}
+
+static bool append_file(BufferedWriter &out, const char *path, char *buffer, size_t size) {
+    auto fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOGE("open %s failed: %s", path, strerror(errno));
+        return false;
+    }
+    auto ok = true;
+    while (true) {
+        auto n = ::read(fd, buffer, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOGE("read %s failed: %s", path, strerror(errno));
+            ok = false;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        out.write(buffer, n);
+    }
+    ::close(fd);
+    return ok;
+}
+
+bool BinaryDumpWriter::close(uint64_t il2cpp_base) {
+    auto ok = true;
+    uint64_t sizes[BINARY_DUMP_SECTION_COUNT];
+    for (int i = 0; i < BINARY_DUMP_SECTION_COUNT; ++i) {
+        sizes[i] = sections[i]->size();
+        ok = sections[i]->close() && ok;
+    }
+    if (ok) {
+        BinaryDumpHeader header{};
+        memcpy(header.magic, kBinaryDumpMagic, sizeof(header.magic));
+        header.version = kBinaryDumpVersion;
+        header.header_size = sizeof(header);
+        header.il2cpp_base = il2cpp_base;
+        uint64_t offset = sizeof(header);
+        for (int i = 0; i < BINARY_DUMP_SECTION_COUNT; ++i) {
+            header.sections[i].offset = offset;
+            header.sections[i].count = counts[i];
+            offset = (offset + sizes[i] + 7) & ~(uint64_t) 7;
+        }
+        BufferedWriter out;
+        ok = out.open(path.c_str());
+        if (ok) {
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            auto buffer = std::make_unique<char[]>(BufferedWriter::kDefaultCapacity);
+            static constexpr char kPadding[8] = {};
+            for (int i = 0; i < BINARY_DUMP_SECTION_COUNT && ok; ++i) {
+                ok = append_file(out, section_path(i).c_str(), buffer.get(), BufferedWriter::kDefaultCapacity);
+                out.write(kPadding, (8 - sizes[i] % 8) % 8);
+            }
+            ok = out.close() && ok;
+        }
+        if (ok) {
+            file_size = out.size();
+            LOGI("binary dump: %" PRIu64 " types, %" PRIu64 " methods, %" PRIu64 " bytes of strings, %zu bytes",
+                 counts[BINARY_DUMP_TYPES], counts[BINARY_DUMP_METHODS], counts[BINARY_DUMP_STRINGS], out.size());
+        }
+    }
+    remove_sections();
+    interned.clear();
+    return ok;
+}
@@ -0,0 +1,92 @@
+#ifndef ZYGISK_IL2CPPDUMPER_BINARY_DUMP_WRITER_H
+#define ZYGISK_IL2CPPDUMPER_BINARY_DUMP_WRITER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "buffered_writer.h"
+#include "dump_binary.h"
+#include "pointer_cache.h"
+
+// Records of a run of classes as produced by one dump worker. String fields hold indices
+// into `strings`, whose views point into il2cpp metadata, and the *_begin fields are
+// relative to this chunk; BinaryDumpWriter rewrites both when it appends the chunk.
+struct BinaryDumpChunk {
+    std::vector<std::string_view> strings;
+    std::vector<BinaryDumpType> types;
+    std::vector<uint32_t> extends;
+    std::vector<BinaryDumpField> fields;
+    std::vector<BinaryDumpProperty> properties;
+    std::vector<BinaryDumpMethod> methods;
+    std::vector<BinaryDumpParam> params;
+
+    uint32_t add_string(std::string_view str) {
+        if (!str.data()) {
+            return kBinaryDumpNoString;
+        }
+        strings.push_back(str);
+        return (uint32_t) strings.size() - 1;
+    }
+
+    uint32_t add_string(const char *str) {
+        return str ? add_string(std::string_view(str)) : kBinaryDumpNoString;
+    }
+
+    void clear();
+
+    void swap(BinaryDumpChunk &other);
+};
+
+// Writes files/dump.bin. Every section is streamed to its own temporary file while the
+// dump runs and the pieces are concatenated behind the header on close(), so memory
+// stays bounded by the string index rather than by the number of records.
+class BinaryDumpWriter {
+public:
+    BinaryDumpWriter() = default;
+
+    // drops the temporary files of a dump that was never closed
+    ~BinaryDumpWriter();
+
+    BinaryDumpWriter(const BinaryDumpWriter &) = delete;
+
+    BinaryDumpWriter &operator=(const BinaryDumpWriter &) = delete;
+
+    bool open(const char *path);
+
+    // must be called for every image, in order, before its chunks are added
+    void add_image(const char *name, uint32_t type_count, uint32_t flags = 0);
+
+    void add_chunk(const BinaryDumpChunk &chunk);
+
+    bool close(uint64_t il2cpp_base);
+
+    // bytes of dump.bin once close() succeeded
+    uint64_t size() const {
+        return file_size;
+    }
+
+private:
+    uint32_t intern(std::string_view str);
+
+    void remove_sections();
+
+    void write(BinaryDumpSectionId id, const void *data, size_t count, size_t size);
+
+    std::string section_path(int id) const;
+
+    std::string path;
+    std::unique_ptr<BufferedWriter> sections[BINARY_DUMP_SECTION_COUNT];
+    uint64_t counts[BINARY_DUMP_SECTION_COUNT] = {};
+    uint32_t next_type = 0;
+    uint64_t file_size = 0;
+    // il2cpp hands out the same pointer for the same name most of the time,
+    // the content index catches the rest
+    PointerCache<uint32_t> interned_pointers{4096};
+    std::unordered_map<std::string_view, uint32_t> interned;
+    std::vector<uint32_t> remap;
+};
+
+#endif //ZYGISK_IL2CPPDUMPER_BINARY_DUMP_WRITER_H
@@ -0,0 +1,87 @@
+#include "buffered_writer.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "log.h"
+
+BufferedWriter::BufferedWriter(size_t capacity) : buffer(new char[capacity]), capacity(capacity) {
+}
+
+BufferedWriter::~BufferedWriter() {
+    close();
+}
+
+bool BufferedWriter::open(const char *path) {
+    close();
+    fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOGE("open %s failed: %s", path, strerror(errno));
+        return false;
+    }
+    used = 0;
+    written = 0;
+    error = false;
+    return true;
+}
+
+void BufferedWriter::write(const char *data, size_t size) {
+    if (fd < 0 || error) {
+        return;
+    }
+    if (used + size > capacity) {
+        if (!flush()) {
+            return;
+        }
+        if (size >= capacity) {
+            // too large to be worth copying, hand it to the kernel as is
+            if (write_fully(data, size)) {
+                written += size;
+            }
+            return;
+        }
+    }
+    memcpy(buffer.get() + used, data, size);
+    used += size;
+}
+
+bool BufferedWriter::close() {
+    if (fd < 0) {
+        return !error;
+    }
+    flush();
+    if (::close(fd) != 0) {
+        LOGE("close failed: %s", strerror(errno));
+        error = true;
+    }
+    fd = -1;
+    return !error;
+}
+
+bool BufferedWriter::flush() {
+    if (used == 0) {
+        return !error;
+    }
+    if (write_fully(buffer.get(), used)) {
+        written += used;
+    }
+    used = 0;
+    return !error;
+}
+
+bool BufferedWriter::write_fully(const char *data, size_t size) {
+    while (size > 0) {
+        auto n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOGE("write failed: %s", strerror(errno));
+            error = true;
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef ZYGISK_IL2CPPDUMPER_BUFFERED_WRITER_H
+#define ZYGISK_IL2CPPDUMPER_BUFFERED_WRITER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "dump_sink.h"
+
+// Append-only file writer backed by one fixed-size buffer that is flushed to disk
+// whenever it fills up, so memory use stays bounded regardless of the output size.
+class BufferedWriter : public DumpSink {
+public:
+    static constexpr size_t kDefaultCapacity = 1 << 20;
+
+    explicit BufferedWriter(size_t capacity = kDefaultCapacity);
+
+    ~BufferedWriter() override;
+
+    BufferedWriter(const BufferedWriter &) = delete;
+
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    bool open(const char *path) override;
+
+    void write(const char *data, size_t size) override;
+
+    using DumpSink::write;
+
+    bool close() override;
+
+    bool failed() const override {
+        return error;
+    }
+
+    size_t size() const override {
+        return written + used;
+    }
+
+private:
+    bool flush();
+
+    bool write_fully(const char *data, size_t size);
+
+    int fd = -1;
+    std::unique_ptr<char[]> buffer;
+    size_t capacity;
+    size_t used = 0;
+    size_t written = 0;
+    bool error = false;
+};
+
+#endif //ZYGISK_IL2CPPDUMPER_BUFFERED_WRITER_H
@@ -0,0 +1,132 @@
+#ifndef ZYGISK_IL2CPPDUMPER_DUMP_BINARY_H
+#define ZYGISK_IL2CPPDUMPER_DUMP_BINARY_H
+
+// Layout of files/dump.bin, the binary alternative to dump.cs.
+//
+// The file is a BinaryDumpHeader followed by 8-byte aligned sections of fixed-size
+// little-endian records, so a consumer can mmap it and index the arrays in place.
+// Strings are stored once in the string table and referenced by their byte offset;
+// offset 0 is the empty string and kBinaryDumpNoString stands for a null name.
+// Records of one type are contiguous: a type owns `field_count` fields starting at
+// `field_begin`, and so on.
+
+#include <cstdint>
+
+static constexpr char kBinaryDumpMagic[8] = {'I', 'L', '2', 'C', 'P', 'P', 'D', 'B'};
+static constexpr uint32_t kBinaryDumpVersion = 1;
+static constexpr uint32_t kBinaryDumpNoString = UINT32_MAX;
+
+enum BinaryDumpSectionId {
+    BINARY_DUMP_STRINGS,    // char[], count is the size in bytes
+    BINARY_DUMP_IMAGES,     // BinaryDumpImage
+    BINARY_DUMP_TYPES,      // BinaryDumpType
+    BINARY_DUMP_EXTENDS,    // uint32_t string offsets of parents and interfaces
+    BINARY_DUMP_FIELDS,     // BinaryDumpField
+    BINARY_DUMP_PROPERTIES, // BinaryDumpProperty
+    BINARY_DUMP_METHODS,    // BinaryDumpMethod
+    BINARY_DUMP_PARAMS,     // BinaryDumpParam
+    BINARY_DUMP_SECTION_COUNT
+};
+
+struct BinaryDumpSection {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct BinaryDumpHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t il2cpp_base;
+    BinaryDumpSection sections[BINARY_DUMP_SECTION_COUNT];
+};
+
+// BinaryDumpImage::flags
+// left out by the dump filter, the image has no types
+static constexpr uint32_t BINARY_DUMP_IMAGE_SKIPPED = 1 << 0;
+
+struct BinaryDumpImage {
+    uint32_t name;
+    uint32_t type_begin;
+    uint32_t type_count;
+    uint32_t flags;
+};
+
+// BinaryDumpType::kind
+static constexpr uint32_t BINARY_DUMP_TYPE_VALUETYPE = 1 << 0;
+static constexpr uint32_t BINARY_DUMP_TYPE_ENUM = 1 << 1;
+// the first extends entry is the base class, the rest are interfaces
+static constexpr uint32_t BINARY_DUMP_TYPE_HAS_PARENT = 1 << 2;
+
+struct BinaryDumpType {
+    uint32_t image;
+    uint32_t namespaze;
+    uint32_t name;
+    uint32_t flags; // TYPE_ATTRIBUTE_*
+    uint32_t kind;
+    uint32_t extends_begin;
+    uint32_t extends_count;
+    uint32_t field_begin;
+    uint32_t field_count;
+    uint32_t property_begin;
+    uint32_t property_count;
+    uint32_t method_begin;
+    uint32_t method_count;
+    uint32_t reserved;
+};
+
+// BinaryDumpField::bits
+static constexpr uint32_t BINARY_DUMP_FIELD_HAS_VALUE = 1 << 0;
+
+struct BinaryDumpField {
+    uint32_t name;
+    uint32_t type;
+    uint32_t flags; // FIELD_ATTRIBUTE_*
+    uint32_t bits;
+    uint64_t offset;
+    uint64_t value; // constant value of enum members
+};
+
+// BinaryDumpProperty::bits
+static constexpr uint32_t BINARY_DUMP_PROPERTY_GET = 1 << 0;
+static constexpr uint32_t BINARY_DUMP_PROPERTY_SET = 1 << 1;
+// the property type could not be resolved, `type` is meaningless
+static constexpr uint32_t BINARY_DUMP_PROPERTY_UNKNOWN = 1 << 2;
+
+struct BinaryDumpProperty {
+    uint32_t name;
+    uint32_t type;
+    uint32_t flags; // METHOD_ATTRIBUTE_* of the getter, or of the setter without getter
+    uint32_t bits;
+};
+
+// BinaryDumpMethod::bits and BinaryDumpParam::bits
+static constexpr uint32_t BINARY_DUMP_BYREF = 1 << 0;
+
+struct BinaryDumpMethod {
+    uint32_t name;
+    uint32_t return_type;
+    uint32_t flags; // METHOD_ATTRIBUTE_*
+    uint32_t bits;
+    uint64_t rva;
+    uint64_t va; // 0 when the method has no code
+    uint32_t param_begin;
+    uint32_t param_count;
+};
+
+struct BinaryDumpParam {
+    uint32_t name;
+    uint32_t type;
+    uint32_t attrs; // PARAM_ATTRIBUTE_*
+    uint32_t bits;
+};
+
+static_assert(sizeof(BinaryDumpHeader) == 152);
+static_assert(sizeof(BinaryDumpImage) == 16);
+static_assert(sizeof(BinaryDumpType) == 56);
+static_assert(sizeof(BinaryDumpField) == 32);
+static_assert(sizeof(BinaryDumpProperty) == 16);
+static_assert(sizeof(BinaryDumpMethod) == 40);
+static_assert(sizeof(BinaryDumpParam) == 16);
+
+#endif //ZYGISK_IL2CPPDUMPER_DUMP_BINARY_H
@@ -0,0 +1,30 @@
+#ifndef ZYGISK_IL2CPPDUMPER_DUMP_CONFIG_H
+#define ZYGISK_IL2CPPDUMPER_DUMP_CONFIG_H
+
+#include "dump_filter.h"
+
+enum class DumpFormat {
+    // files/dump.cs
+    Text,
+    // files/dump.bin, see dump_binary.h; tools/dump2cs turns it back into dump.cs
+    Binary,
+};
+
+struct DumpConfig {
+    // number of threads rendering classes, 0 picks one per big core
+    int worker_count = 0;
+    DumpFormat format = DumpFormat::Text;
+    // text format only: copy images whose fingerprint matches files/dump.manifest from
+    // the previous dump.cs instead of rendering them again
+    bool incremental = true;
+    // 1-9 compresses the text dump on its own thread into files/dump.cs.gz, 0 writes dump.cs
+    int gzip_level = 0;
+    // fdatasync the dump before reporting it done
+    bool sync_output = false;
+    // phase timings, counters and peak RSS in files/dump_stats.json
+    bool stats = true;
+    // images and namespaces left out of the dump
+    DumpFilter filter;
+};
+
+#endif //ZYGISK_IL2CPPDUMPER_DUMP_CONFIG_H
@@ -0,0 +1,94 @@
+#include "dump_filter.h"
+#include <fnmatch.h>
+#include "log.h"
+
+static constexpr char kGlobalNamespace[] = "<global>";
+
+static std::string_view trim(std::string_view str) {
+    auto begin = str.find_first_not_of(" \t\r");
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    auto end = str.find_last_not_of(" \t\r");
+    return str.substr(begin, end - begin + 1);
+}
+
+// splits off the first whitespace-separated word of `line`
+static std::string_view next_word(std::string_view &line) {
+    line = trim(line);
+    auto end = line.find_first_of(" \t");
+    auto word = line.substr(0, end);
+    line = end == std::string_view::npos ? std::string_view() : trim(line.substr(end));
+    return word;
+}
+
+void DumpFilter::parse(std::string_view text) {
+    int line_number = 0;
+    while (!text.empty()) {
+        auto end = text.find('\n');
+        auto line = text.substr(0, end);
+        text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+        ++line_number;
+        auto comment = line.find('#');
+        if (comment != std::string_view::npos) {
+            line = line.substr(0, comment);
+        }
+        line = trim(line);
+        if (line.empty()) {
+            continue;
+        }
+        auto rest = line;
+        auto action = next_word(rest);
+        auto kind = next_word(rest);
+        auto pattern = rest;
+        Rules *rules = kind == "image" ? &images : kind == "namespace" ? &namespaces : nullptr;
+        auto allow = action == "allow";
+        if (!rules || (!allow && action != "deny") || pattern.empty()) {
+            LOGW("dump filter: ignoring line %d: %.*s", line_number, (int) line.size(), line.data());
+            continue;
+        }
+        (allow ? rules->allow : rules->deny).emplace_back(pattern);
+    }
+}
+
+bool DumpFilter::Rules::allows(const char *name) const {
+    if (!name) {
+        name = "";
+    }
+    for (auto &pattern: deny) {
+        if (fnmatch(pattern.c_str(), name, 0) == 0) {
+            return false;
+        }
+    }
+    if (allow.empty()) {
+        return true;
+    }
+    for (auto &pattern: allow) {
+        if (fnmatch(pattern.c_str(), name, 0) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t DumpFilter::hash() const {
+    // FNV-1a over every pattern, each list ended by a byte no pattern contains
+    auto hash = 0xcbf29ce484222325ull;
+    for (auto list: {&images.allow, &images.deny, &namespaces.allow, &namespaces.deny}) {
+        for (auto &pattern: *list) {
+            for (auto c: pattern) {
+                hash = (hash ^ (unsigned char) c) * 0x100000001b3ull;
+            }
+            hash = (hash ^ '\n') * 0x100000001b3ull;
+        }
+        hash = (hash ^ '\0') * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool DumpFilter::allows_namespace(const char *namespaze) const {
+    if (!namespaze || !*namespaze) {
+        namespaze = kGlobalNamespace;
+    }
+    return namespaces.allows(namespaze);
+}
@@ -0,0 +1,56 @@
+#ifndef ZYGISK_IL2CPPDUMPER_DUMP_FILTER_H
+#define ZYGISK_IL2CPPDUMPER_DUMP_FILTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Images and namespaces to leave out of the dump, read from dump_filter.conf in the module
+// directory. One rule per line, `#` starts a comment:
+//
+//   allow image Assembly-CSharp.dll
+//   allow image Game.*
+//   deny namespace UnityEngine.*
+//
+// Patterns are fnmatch() globs, `<global>` stands for the empty namespace of top-level types;
+// nested types are matched by the namespace of their outermost declaring type. Once a kind has an
+// allow rule only names matching one pass; a deny rule always wins over an allow rule.
+class DumpFilter {
+public:
+    // adds the rules in `text`, malformed lines are logged and skipped
+    void parse(std::string_view text);
+
+    bool empty() const {
+        return images.empty() && namespaces.empty();
+    }
+
+    bool has_namespace_rules() const {
+        return !namespaces.empty();
+    }
+
+    bool allows_image(const char *name) const {
+        return images.allows(name);
+    }
+
+    bool allows_namespace(const char *namespaze) const;
+
+    // changes with the rules, so a dump made with other rules is recognized
+    uint64_t hash() const;
+
+private:
+    struct Rules {
+        std::vector<std::string> allow;
+        std::vector<std::string> deny;
+
+        bool empty() const {
+            return allow.empty() && deny.empty();
+        }
+
+        bool allows(const char *name) const;
+    };
+
+    Rules images;
+    Rules namespaces;
+};
+
+#endif //ZYGISK_IL2CPPDUMPER_DUMP_FILTER_H
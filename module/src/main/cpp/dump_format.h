@@ -0,0 +1,169 @@
+#ifndef ZYGISK_IL2CPPDUMPER_DUMP_FORMAT_H
+#define ZYGISK_IL2CPPDUMPER_DUMP_FORMAT_H
+
+// The parts of the dump.cs syntax that only depend on metadata flags. Shared by the
+// on-device renderer and the host-side binary dump converter so both produce the
+// same text.
+
+#include <cstdint>
+#include "il2cpp-tabledefs.h"
+#include "text_builder.h"
+
+inline void dump_method_modifier(TextBuilder &outPut, uint32_t flags) {
+    auto access = flags & METHOD_ATTRIBUTE_MEMBER_ACCESS_MASK;
+    switch (access) {
+        case METHOD_ATTRIBUTE_PRIVATE:
+            outPut << "private ";
+            break;
+        case METHOD_ATTRIBUTE_PUBLIC:
+            outPut << "public ";
+            break;
+        case METHOD_ATTRIBUTE_FAMILY:
+            outPut << "protected ";
+            break;
+        case METHOD_ATTRIBUTE_ASSEM:
+        case METHOD_ATTRIBUTE_FAM_AND_ASSEM:
+            outPut << "internal ";
+            break;
+        case METHOD_ATTRIBUTE_FAM_OR_ASSEM:
+            outPut << "protected internal ";
+            break;
+    }
+    if (flags & METHOD_ATTRIBUTE_STATIC) {
+        outPut << "static ";
+    }
+    if (flags & METHOD_ATTRIBUTE_ABSTRACT) {
+        outPut << "abstract ";
+        if ((flags & METHOD_ATTRIBUTE_VTABLE_LAYOUT_MASK) == METHOD_ATTRIBUTE_REUSE_SLOT) {
+            outPut << "override ";
+        }
+    } else if (flags & METHOD_ATTRIBUTE_FINAL) {
+        if ((flags & METHOD_ATTRIBUTE_VTABLE_LAYOUT_MASK) == METHOD_ATTRIBUTE_REUSE_SLOT) {
+            outPut << "sealed override ";
+        }
+    } else if (flags & METHOD_ATTRIBUTE_VIRTUAL) {
+        if ((flags & METHOD_ATTRIBUTE_VTABLE_LAYOUT_MASK) == METHOD_ATTRIBUTE_NEW_SLOT) {
+            outPut << "virtual ";
+        } else {
+            outPut << "override ";
+        }
+    }
+    if (flags & METHOD_ATTRIBUTE_PINVOKE_IMPL) {
+        outPut << "extern ";
+    }
+}
+
+inline void dump_method_address(TextBuilder &outPut, uint64_t rva, uint64_t va) {
+    if (va) {
+        outPut << "\t// RVA: 0x";
+        outPut.append_hex(rva);
+        outPut << " VA: 0x";
+        outPut.append_hex(va);
+    } else {
+        outPut << "\t// RVA: 0x VA: 0x0";
+    }
+}
+
+inline void dump_param_modifier(TextBuilder &outPut, uint32_t attrs, bool byref) {
+    if (byref) {
+        if (attrs & PARAM_ATTRIBUTE_OUT && !(attrs & PARAM_ATTRIBUTE_IN)) {
+            outPut << "out ";
+        } else if (attrs & PARAM_ATTRIBUTE_IN && !(attrs & PARAM_ATTRIBUTE_OUT)) {
+            outPut << "in ";
+        } else {
+            outPut << "ref ";
+        }
+    } else {
+        if (attrs & PARAM_ATTRIBUTE_IN) {
+            outPut << "[In] ";
+        }
+        if (attrs & PARAM_ATTRIBUTE_OUT) {
+            outPut << "[Out] ";
+        }
+    }
+}
+
+inline void dump_field_modifier(TextBuilder &outPut, uint32_t attrs) {
+    auto access = attrs & FIELD_ATTRIBUTE_FIELD_ACCESS_MASK;
+    switch (access) {
+        case FIELD_ATTRIBUTE_PRIVATE:
+            outPut << "private ";
+            break;
+        case FIELD_ATTRIBUTE_PUBLIC:
+            outPut << "public ";
+            break;
+        case FIELD_ATTRIBUTE_FAMILY:
+            outPut << "protected ";
+            break;
+        case FIELD_ATTRIBUTE_ASSEMBLY:
+        case FIELD_ATTRIBUTE_FAM_AND_ASSEM:
+            outPut << "internal ";
+            break;
+        case FIELD_ATTRIBUTE_FAM_OR_ASSEM:
+            outPut << "protected internal ";
+            break;
+    }
+    if (attrs & FIELD_ATTRIBUTE_LITERAL) {
+        outPut << "const ";
+    } else {
+        if (attrs & FIELD_ATTRIBUTE_STATIC) {
+            outPut << "static ";
+        }
+        if (attrs & FIELD_ATTRIBUTE_INIT_ONLY) {
+            outPut << "readonly ";
+        }
+    }
+}
+
+// everything between the attributes and the type name, e.g. "public sealed class "
+inline void dump_type_modifier(TextBuilder &outPut, uint32_t flags, bool is_valuetype, bool is_enum) {
+    auto visibility = flags & TYPE_ATTRIBUTE_VISIBILITY_MASK;
+    switch (visibility) {
+        case TYPE_ATTRIBUTE_PUBLIC:
+        case TYPE_ATTRIBUTE_NESTED_PUBLIC:
+            outPut << "public ";
+            break;
+        case TYPE_ATTRIBUTE_NOT_PUBLIC:
+        case TYPE_ATTRIBUTE_NESTED_FAM_AND_ASSEM:
+        case TYPE_ATTRIBUTE_NESTED_ASSEMBLY:
+            outPut << "internal ";
+            break;
+        case TYPE_ATTRIBUTE_NESTED_PRIVATE:
+            outPut << "private ";
+            break;
+        case TYPE_ATTRIBUTE_NESTED_FAMILY:
+            outPut << "protected ";
+            break;
+        case TYPE_ATTRIBUTE_NESTED_FAM_OR_ASSEM:
+            outPut << "protected internal ";
+            break;
+    }
+    if (flags & TYPE_ATTRIBUTE_ABSTRACT && flags & TYPE_ATTRIBUTE_SEALED) {
+        outPut << "static ";
+    } else if (!(flags & TYPE_ATTRIBUTE_INTERFACE) && flags & TYPE_ATTRIBUTE_ABSTRACT) {
+        outPut << "abstract ";
+    } else if (!is_valuetype && !is_enum && flags & TYPE_ATTRIBUTE_SEALED) {
+        outPut << "sealed ";
+    }
+    if (flags & TYPE_ATTRIBUTE_INTERFACE) {
+        outPut << "interface ";
+    } else if (is_enum) {
+        outPut << "enum ";
+    } else if (is_valuetype) {
+        outPut << "struct ";
+    } else {
+        outPut << "class ";
+    }
+}
+
+inline void dump_image_line(TextBuilder &outPut, uint64_t index, const char *name, bool skipped = false) {
+    outPut << "// Image ";
+    outPut.append_dec(index);
+    outPut << ": " << name;
+    if (skipped) {
+        outPut << " (skipped by filter)";
+    }
+    outPut << "\n";
+}
+
+#endif //ZYGISK_IL2CPPDUMPER_DUMP_FORMAT_H
@@ -0,0 +1,199 @@
+#include "dump_manifest.h"
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unistd.h>
+#include "text_builder.h"
+#include "log.h"
+
+static constexpr char kManifestMagic[] = "il2cpp-dump-manifest";
+static constexpr size_t kCopyBlockSize = 1 << 20;
+
+bool DumpManifest::load(const char *path) {
+    auto fp = fopen(path, "re");
+    if (!fp) {
+        return false;
+    }
+    images.clear();
+    char *line = nullptr;
+    size_t capacity = 0;
+    ssize_t length;
+    auto ok = true;
+    auto line_no = 0;
+    while (ok && (length = getline(&line, &capacity, fp)) > 0) {
+        if (line[length - 1] == '\n') {
+            line[length - 1] = '\0';
+        }
+        switch (line_no++) {
+            case 0: {
+                char magic[32];
+                int version = 0;
+                ok = sscanf(line, "%31s %d", magic, &version) == 2 && strcmp(magic, kManifestMagic) == 0 &&
+                     version == kVersion;
+                break;
+            }
+            case 1: {
+                char id[129];
+                ok = sscanf(line, "build_id %128s", id) == 1;
+                build_id = id;
+                break;
+            }
+            case 2:
+                ok = sscanf(line, "filter %" SCNx64, &filter_hash) == 1;
+                break;
+            case 3:
+                ok = sscanf(line, "base %" SCNx64, &il2cpp_base) == 1;
+                break;
+            case 4:
+                ok = sscanf(line, "size %" SCNu64, &dump_size) == 1;
+                break;
+            default: {
+                ManifestImage image;
+                int name_offset = 0;
+                ok = sscanf(line, "image %" SCNu64 " %" SCNx64 " %" SCNu64 " %" SCNu64 " %n", &image.class_count,
+                            &image.fingerprint, &image.offset, &image.length, &name_offset) == 4 &&
+                     name_offset > 0 && image.offset <= dump_size && image.length <= dump_size - image.offset;
+                if (ok) {
+                    image.name = line + name_offset;
+                    images.push_back(std::move(image));
+                }
+                break;
+            }
+        }
+    }
+    free(line);
+    fclose(fp);
+    if (!ok || line_no < 5) {
+        LOGW("ignoring invalid manifest %s", path);
+        images.clear();
+        return false;
+    }
+    return true;
+}
+
+bool DumpManifest::save(const char *path) const {
+    auto tmp_path = std::string(path).append(".tmp");
+    auto fp = fopen(tmp_path.c_str(), "we");
+    if (!fp) {
+        LOGE("open %s failed: %s", tmp_path.c_str(), strerror(errno));
+        return false;
+    }
+    fprintf(fp, "%s %d\n", kManifestMagic, kVersion);
+    fprintf(fp, "build_id %s\n", build_id.c_str());
+    fprintf(fp, "filter %" PRIx64 "\n", filter_hash);
+    fprintf(fp, "base %" PRIx64 "\n", il2cpp_base);
+    fprintf(fp, "size %" PRIu64 "\n", dump_size);
+    for (auto &image: images) {
+        fprintf(fp, "image %" PRIu64 " %" PRIx64 " %" PRIu64 " %" PRIu64 " %s\n", image.class_count,
+                image.fingerprint, image.offset, image.length, image.name.c_str());
+    }
+    auto ok = !ferror(fp);
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(tmp_path.c_str(), path) != 0) {
+        LOGE("write %s failed: %s", path, strerror(errno));
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// number of leading hex digits of `str`, their value goes to `value`
+static size_t parse_hex(std::string_view str, uint64_t &value) {
+    value = 0;
+    size_t length = 0;
+    for (; length < str.size(); ++length) {
+        auto c = str[length];
+        if (c >= '0' && c <= '9') {
+            value = value << 4 | (c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            value = value << 4 | (c - 'a' + 10);
+        } else {
+            break;
+        }
+    }
+    return length;
+}
+
+// "\t// RVA: 0x<rva> VA: 0x<va>..." gets <va> replaced by <rva> + new_base, anything else is kept
+static void rebase_line(std::string_view line, uint64_t new_base, TextBuilder &outPut) {
+    static constexpr std::string_view kRva = "\t// RVA: 0x";
+    static constexpr std::string_view kVa = " VA: 0x";
+    if (line.substr(0, kRva.size()) != kRva) {
+        outPut << line;
+        return;
+    }
+    uint64_t rva;
+    auto rva_digits = parse_hex(line.substr(kRva.size()), rva);
+    auto va_begin = kRva.size() + rva_digits;
+    if (rva_digits == 0 || rva_digits > 16 || line.substr(va_begin, kVa.size()) != kVa) {
+        outPut << line;
+        return;
+    }
+    uint64_t va;
+    auto tail = va_begin + kVa.size();
+    tail += parse_hex(line.substr(tail), va);
+    outPut << line.substr(0, va_begin + kVa.size());
+    outPut.append_hex(rva + new_base);
+    outPut << line.substr(tail);
+}
+
+bool copy_manifest_image(int fd, const ManifestImage &image, uint64_t old_base, uint64_t new_base,
+                         DumpSink &out) {
+    auto buffer = std::make_unique<char[]>(kCopyBlockSize);
+    TextBuilder rebased;
+    // a line that straddles two blocks
+    TextBuilder partial;
+    auto offset = image.offset;
+    auto remaining = image.length;
+    while (remaining > 0) {
+        auto n = pread(fd, buffer.get(), std::min<uint64_t>(remaining, kCopyBlockSize), (off_t) offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOGE("read previous dump failed: %s", strerror(errno));
+            return false;
+        }
+        if (n == 0) {
+            LOGE("previous dump is truncated");
+            return false;
+        }
+        offset += n;
+        remaining -= n;
+        if (old_base == new_base) {
+            out.write(buffer.get(), n);
+            continue;
+        }
+        rebased.clear();
+        const char *p = buffer.get();
+        const char *end = p + n;
+        while (p < end) {
+            auto newline = static_cast<const char *>(memchr(p, '\n', end - p));
+            if (!newline) {
+                partial.append(p, end - p);
+                break;
+            }
+            auto line = std::string_view(p, newline + 1 - p);
+            if (partial.empty()) {
+                rebase_line(line, new_base, rebased);
+            } else {
+                partial << line;
+                rebase_line(partial.view(), new_base, rebased);
+                partial.clear();
+            }
+            p = newline + 1;
+        }
+        out.write(rebased.view());
+    }
+    if (!partial.empty()) {
+        rebased.clear();
+        rebase_line(partial.view(), new_base, rebased);
+        out.write(rebased.view());
+    }
+    return !out.failed();
+}
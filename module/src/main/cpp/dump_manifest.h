@@ -0,0 +1,43 @@
+#ifndef ZYGISK_IL2CPPDUMPER_DUMP_MANIFEST_H
+#define ZYGISK_IL2CPPDUMPER_DUMP_MANIFEST_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "dump_sink.h"
+
+// Where each image ended up in the previous dump.cs and what it looked like, so an
+// unchanged image can be copied from there instead of being rendered again.
+struct ManifestImage {
+    std::string name;
+    uint64_t class_count = 0;
+    uint64_t fingerprint = 0;
+    // byte range of the image's classes in dump.cs
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+struct DumpManifest {
+    // bump whenever dump.cs rendering changes, so old fragments are not reused
+    static constexpr int kVersion = 2;
+
+    // NT_GNU_BUILD_ID of libil2cpp.so and DumpFilter::hash() of the dump; no fragment is reused
+    // when either differs, the fingerprints only tell images of the same build apart
+    std::string build_id;
+    uint64_t filter_hash = 0;
+    uint64_t il2cpp_base = 0;
+    uint64_t dump_size = 0;
+    std::vector<ManifestImage> images;
+
+    bool load(const char *path);
+
+    // written to a temporary file and renamed into place
+    bool save(const char *path) const;
+};
+
+// Copies the fragment of `image` from the previous dump.cs open as `fd` into `out`. When
+// libil2cpp was loaded at a different address, every "VA: 0x" is recomputed from its RVA.
+bool copy_manifest_image(int fd, const ManifestImage &image, uint64_t old_base, uint64_t new_base,
+                         DumpSink &out);
+
+#endif //ZYGISK_IL2CPPDUMPER_DUMP_MANIFEST_H
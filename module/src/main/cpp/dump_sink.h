@@ -0,0 +1,29 @@
+#ifndef ZYGISK_IL2CPPDUMPER_DUMP_SINK_H
+#define ZYGISK_IL2CPPDUMPER_DUMP_SINK_H
+
+#include <cstddef>
+#include <string_view>
+
+// Where the rendered dump.cs text goes: a plain file or a compressing stage in front of one.
+// Only ever driven from a single thread.
+class DumpSink {
+public:
+    virtual ~DumpSink() = default;
+
+    virtual bool open(const char *path) = 0;
+
+    virtual void write(const char *data, size_t size) = 0;
+
+    void write(std::string_view str) {
+        write(str.data(), str.size());
+    }
+
+    virtual bool close() = 0;
+
+    virtual bool failed() const = 0;
+
+    // bytes handed to write() so far, before any compression
+    virtual size_t size() const = 0;
+};
+
+#endif //ZYGISK_IL2CPPDUMPER_DUMP_SINK_H
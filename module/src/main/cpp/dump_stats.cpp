@@ -0,0 +1,154 @@
+#include "dump_stats.h"
+#include <cinttypes>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include "buffered_writer.h"
+#include "text_builder.h"
+
+void DumpStats::phase(const char *name) {
+    if (!enabled) {
+        return;
+    }
+    auto now = monotonic_ns();
+    if (running) {
+        phases.push_back({running, now - running_since});
+        sample_rss();
+    }
+    running = name;
+    running_since = now;
+}
+
+void DumpStats::add_phase(const char *name, uint64_t ns) {
+    if (enabled) {
+        phases.push_back({name, ns});
+    }
+}
+
+void DumpStats::sample_rss() {
+    if (!enabled) {
+        return;
+    }
+    auto fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    char buffer[128];
+    auto n = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (n <= 0) {
+        return;
+    }
+    buffer[n] = '\0';
+    // "size resident shared text lib data dt", in pages
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    if (sscanf(buffer, "%" SCNu64 " %" SCNu64, &size, &resident) == 2) {
+        auto rss = resident * (uint64_t) sysconf(_SC_PAGESIZE);
+        if (rss > peak_rss) {
+            peak_rss = rss;
+        }
+    }
+}
+
+static void append_json_string(TextBuilder &out, const char *str) {
+    out << '"';
+    for (; str && *str; ++str) {
+        auto c = (unsigned char) *str;
+        if (c == '"' || c == '\\') {
+            out << '\\' << (char) c;
+        } else if (c < 0x20) {
+            static constexpr char kHex[] = "0123456789abcdef";
+            out << "\\u00" << kHex[c >> 4] << kHex[c & 0xf];
+        } else {
+            out << (char) c;
+        }
+    }
+    out << '"';
+}
+
+static void append_ms(TextBuilder &out, uint64_t ns) {
+    // fixed three decimals without going through printf
+    out.append_dec(ns / 1000000);
+    auto micros = ns / 1000 % 1000;
+    out << '.' << (char) ('0' + micros / 100) << (char) ('0' + micros / 10 % 10) << (char) ('0' + micros % 10);
+}
+
+bool DumpStats::write(const char *path) {
+    if (!enabled) {
+        return true;
+    }
+    phase(nullptr);
+    TextBuilder out;
+    out << "{\n  \"format\": ";
+    append_json_string(out, format);
+    out << ",\n  \"workers\": ";
+    out.append_dec(workers);
+    out << ",\n  \"gzip_level\": ";
+    out.append_dec(gzip_level);
+    out << ",\n  \"phases_ms\": [";
+    uint64_t total = 0;
+    for (size_t i = 0; i < phases.size(); ++i) {
+        out << (i ? ",\n    " : "\n    ") << "{\"name\": ";
+        append_json_string(out, phases[i].name);
+        out << ", \"ms\": ";
+        append_ms(out, phases[i].ns);
+        out << "}";
+        total += phases[i].ns;
+    }
+    out << "\n  ],\n  \"total_ms\": ";
+    append_ms(out, total);
+    if (first_class_ns) {
+        out << ",\n  \"first_class_after_init_ms\": ";
+        append_ms(out, first_class_ns);
+    }
+    size_t reused = 0;
+    size_t skipped = 0;
+    uint64_t filtered = 0;
+    for (auto &image: images) {
+        reused += image.reused;
+        skipped += image.skipped;
+        filtered += image.filtered;
+    }
+    out << ",\n  \"counters\": {\"images\": ";
+    out.append_dec(images.size());
+    out << ", \"images_reused\": ";
+    out.append_dec(reused);
+    out << ", \"images_skipped\": ";
+    out.append_dec(skipped);
+    out << ", \"classes\": ";
+    out.append_dec(counters.classes);
+    out << ", \"classes_filtered\": ";
+    out.append_dec(filtered);
+    out << ", \"fields\": ";
+    out.append_dec(counters.fields);
+    out << ", \"properties\": ";
+    out.append_dec(counters.properties);
+    out << ", \"methods\": ";
+    out.append_dec(counters.methods);
+    out << ", \"bytes\": ";
+    out.append_dec(bytes);
+    out << "},\n  \"peak_rss_bytes\": ";
+    out.append_dec(peak_rss);
+    out << ",\n  \"images\": [";
+    for (size_t i = 0; i < images.size(); ++i) {
+        auto &image = images[i];
+        out << (i ? ",\n    " : "\n    ") << "{\"name\": ";
+        append_json_string(out, image.name.c_str());
+        out << ", \"classes\": ";
+        out.append_dec(image.classes);
+        out << ", \"render_ms\": ";
+        append_ms(out, image.render_ns);
+        out << ", \"filtered\": ";
+        out.append_dec(image.filtered);
+        out << ", \"reused\": " << (image.reused ? "true" : "false");
+        out << ", \"skipped\": " << (image.skipped ? "true" : "false") << "}";
+    }
+    out << "\n  ]\n}\n";
+    BufferedWriter writer;
+    if (!writer.open(path)) {
+        return false;
+    }
+    writer.write(out.view());
+    return writer.close();
+}
@@ -0,0 +1,87 @@
+#ifndef ZYGISK_IL2CPPDUMPER_DUMP_STATS_H
+#define ZYGISK_IL2CPPDUMPER_DUMP_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <time.h>
+
+inline uint64_t monotonic_ns() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+struct DumpCounters {
+    uint64_t classes = 0;
+    uint64_t fields = 0;
+    uint64_t properties = 0;
+    uint64_t methods = 0;
+
+    void add(const DumpCounters &other) {
+        classes += other.classes;
+        fields += other.fields;
+        properties += other.properties;
+        methods += other.methods;
+    }
+};
+
+struct ImageStats {
+    std::string name;
+    uint64_t classes = 0;
+    // summed over the workers that rendered it, or the copy time of a reused image
+    uint64_t render_ns = 0;
+    bool reused = false;
+    // left out entirely by the dump filter
+    bool skipped = false;
+    // classes left out by namespace rules
+    uint64_t filtered = 0;
+};
+
+// Phase timers, counters and peak RSS of one dump, written to dump_stats.json. When
+// disabled, phase() and sample_rss() return immediately and nothing is written.
+class DumpStats {
+public:
+    explicit DumpStats(bool enabled) : enabled(enabled) {
+    }
+
+    bool is_enabled() const {
+        return enabled;
+    }
+
+    // ends the running phase and starts `name`; nullptr only ends it
+    void phase(const char *name);
+
+    // a phase measured before the stats existed
+    void add_phase(const char *name, uint64_t ns);
+
+    // reads the resident set size from /proc/self/statm and keeps the maximum
+    void sample_rss();
+
+    bool write(const char *path);
+
+    const char *format = "text";
+    int workers = 0;
+    int gzip_level = 0;
+    DumpCounters counters;
+    // bytes of dump output before compression
+    uint64_t bytes = 0;
+    // from il2cpp_init returning to the first rendered class, 0 when not measured
+    uint64_t first_class_ns = 0;
+    std::vector<ImageStats> images;
+
+private:
+    struct Phase {
+        const char *name;
+        uint64_t ns;
+    };
+
+    bool enabled;
+    std::vector<Phase> phases;
+    const char *running = nullptr;
+    uint64_t running_since = 0;
+    uint64_t peak_rss = 0;
+};
+
+#endif //ZYGISK_IL2CPPDUMPER_DUMP_STATS_H
@@ -6,5 +6,7 @@
 #define ZYGISK_IL2CPPDUMPER_GAME_H
 
 #define GamePackageName "com.game.packagename"
+// how long to wait for libil2cpp.so to be loaded, 0 waits forever
+#define Il2CppLoadTimeoutSeconds 120
 
 #endif //ZYGISK_IL2CPPDUMPER_GAME_H
@@ -0,0 +1,168 @@
+#include "gzip_writer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "log.h"
+
+static constexpr size_t kDeflateBufferSize = 256 * 1024;
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+GzipWriter::GzipWriter(std::unique_ptr<DumpSink> out, int level) : out(std::move(out)), level(level) {
+}
+
+GzipWriter::~GzipWriter() {
+    close();
+}
+
+bool GzipWriter::open(const char *path) {
+    close();
+    // windowBits + 16 makes zlib emit a gzip header and trailer
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        LOGE("deflateInit2 failed");
+        return false;
+    }
+    stream_ready = true;
+    if (!out->open(path)) {
+        deflateEnd(&stream);
+        stream_ready = false;
+        return false;
+    }
+    deflated.reset(new unsigned char[kDeflateBufferSize]);
+    total_in = 0;
+    deflate_ns = 0;
+    wait_ns = 0;
+    finishing = false;
+    error = false;
+    start_ns = now_ns();
+    compressor = std::thread(&GzipWriter::compress_loop, this);
+    return true;
+}
+
+void GzipWriter::acquire_block() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (free_blocks.empty() && allocated_blocks < kMaxBlocks) {
+        ++allocated_blocks;
+        current.data.reset(new char[kBlockSize]);
+        current.size = 0;
+        return;
+    }
+    if (free_blocks.empty()) {
+        auto begin = now_ns();
+        block_free.wait(lock, [this] { return !free_blocks.empty(); });
+        wait_ns += now_ns() - begin;
+    }
+    current = std::move(free_blocks.back());
+    free_blocks.pop_back();
+    current.size = 0;
+}
+
+void GzipWriter::submit_block() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.push_back(std::move(current));
+    }
+    current = {};
+    block_queued.notify_one();
+}
+
+void GzipWriter::write(const char *data, size_t size) {
+    if (!stream_ready) {
+        return;
+    }
+    total_in += size;
+    while (size > 0) {
+        if (!current.data) {
+            acquire_block();
+        }
+        auto n = std::min(size, kBlockSize - current.size);
+        memcpy(current.data.get() + current.size, data, n);
+        current.size += n;
+        data += n;
+        size -= n;
+        if (current.size == kBlockSize) {
+            submit_block();
+        }
+    }
+}
+
+void GzipWriter::deflate_block(const char *data, size_t size, int flush) {
+    auto begin = now_ns();
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = (uInt) size;
+    do {
+        stream.next_out = deflated.get();
+        stream.avail_out = kDeflateBufferSize;
+        if (deflate(&stream, flush) == Z_STREAM_ERROR) {
+            LOGE("deflate failed");
+            error = true;
+            return;
+        }
+        out->write(reinterpret_cast<const char *>(deflated.get()), kDeflateBufferSize - stream.avail_out);
+    } while (stream.avail_out == 0);
+    deflate_ns += now_ns() - begin;
+    if (out->failed()) {
+        error = true;
+    }
+}
+
+void GzipWriter::compress_loop() {
+    while (true) {
+        Block block;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            block_queued.wait(lock, [this] { return finishing || !queued.empty(); });
+            if (queued.empty()) {
+                break;
+            }
+            block = std::move(queued.front());
+            queued.pop_front();
+        }
+        // keep draining after an error so the producer never waits forever
+        if (!error) {
+            deflate_block(block.data.get(), block.size, Z_NO_FLUSH);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            free_blocks.push_back(std::move(block));
+        }
+        block_free.notify_one();
+    }
+    if (!error) {
+        deflate_block(nullptr, 0, Z_FINISH);
+    }
+}
+
+bool GzipWriter::close() {
+    if (!stream_ready) {
+        return !error;
+    }
+    if (current.data && current.size > 0) {
+        submit_block();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finishing = true;
+    }
+    block_queued.notify_one();
+    compressor.join();
+    deflateEnd(&stream);
+    stream_ready = false;
+    if (!out->close()) {
+        error = true;
+    }
+    auto elapsed = (double) (now_ns() - start_ns) / 1e9;
+    auto compressed = out->size();
+    LOGI("gzip: %zu -> %zu bytes (%.1f%%), deflate %.1f MB/s, %.1f MB/s overall, producer waited %.1f ms",
+         total_in, compressed, total_in ? 100.0 * (double) compressed / (double) total_in : 0.0,
+         deflate_ns ? (double) total_in / 1e6 / ((double) deflate_ns / 1e9) : 0.0,
+         elapsed > 0 ? (double) total_in / 1e6 / elapsed : 0.0, (double) wait_ns / 1e6);
+    queued.clear();
+    free_blocks.clear();
+    current = {};
+    allocated_blocks = 0;
+    return !error;
+}
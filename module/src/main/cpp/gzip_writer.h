@@ -0,0 +1,88 @@
+#ifndef ZYGISK_IL2CPPDUMPER_GZIP_WRITER_H
+#define ZYGISK_IL2CPPDUMPER_GZIP_WRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#include "dump_sink.h"
+
+// Gzip stage in front of another sink. write() only copies into fixed-size blocks; full
+// blocks go through a bounded queue to a compressor thread that deflates them and writes
+// the result to `out`, so rendering, compression and file I/O overlap. The producer only
+// waits when every block is queued.
+class GzipWriter : public DumpSink {
+public:
+    static constexpr size_t kBlockSize = 1 << 20;
+    static constexpr int kMaxBlocks = 4;
+
+    GzipWriter(std::unique_ptr<DumpSink> out, int level);
+
+    ~GzipWriter() override;
+
+    GzipWriter(const GzipWriter &) = delete;
+
+    GzipWriter &operator=(const GzipWriter &) = delete;
+
+    bool open(const char *path) override;
+
+    void write(const char *data, size_t size) override;
+
+    using DumpSink::write;
+
+    bool close() override;
+
+    bool failed() const override {
+        return error;
+    }
+
+    size_t size() const override {
+        return total_in;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+    };
+
+    void acquire_block();
+
+    void submit_block();
+
+    void compress_loop();
+
+    void deflate_block(const char *data, size_t size, int flush);
+
+    std::unique_ptr<DumpSink> out;
+    int level;
+    z_stream stream{};
+    bool stream_ready = false;
+    std::unique_ptr<unsigned char[]> deflated;
+
+    // the block write() is filling, owned by the producer
+    Block current;
+    std::mutex mutex;
+    std::condition_variable block_queued;
+    std::condition_variable block_free;
+    std::deque<Block> queued;
+    std::vector<Block> free_blocks;
+    int allocated_blocks = 0;
+    bool finishing = false;
+    std::thread compressor;
+
+    size_t total_in = 0;
+    // time spent in deflate(), only touched by the compressor thread until it is joined
+    uint64_t deflate_ns = 0;
+    // time write() spent waiting for a free block
+    uint64_t wait_ns = 0;
+    uint64_t start_ns = 0;
+    std::atomic<bool> error{false};
+};
+
+#endif //ZYGISK_IL2CPPDUMPER_GZIP_WRITER_H
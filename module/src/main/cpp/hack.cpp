@@ -3,7 +3,10 @@
 //
 
 #include "hack.h"
+#include "dump_stats.h"
+#include "game.h"
 #include "il2cpp_dump.h"
+#include "load_watcher.h"
 #include "log.h"
 #include "xdl.h"
 #include <cstring>
@@ -17,22 +20,27 @@
 #include <linux/unistd.h>
 #include <array>
 
-void hack_start(const char *game_data_dir) {
-    bool load = false;
-    for (int i = 0; i < 10; i++) {
-        void *handle = xdl_open("libil2cpp.so", 0);
-        if (handle) {
-            load = true;
-            il2cpp_api_init(handle);
-            il2cpp_dump(game_data_dir);
-            break;
-        } else {
-            sleep(1);
-        }
+void hack_start(const char *game_data_dir, const char *dump_filter) {
+    DumpConfig config;
+    if (dump_filter) {
+        config.filter.parse(dump_filter);
     }
-    if (!load) {
-        LOGI("libil2cpp.so not found in thread %d", gettid());
+    uint64_t latency_ns;
+    auto begin = monotonic_ns();
+    auto handle = load_watcher_wait("libil2cpp.so", Il2CppLoadTimeoutSeconds * 1000, latency_ns);
+    auto waited_ms = (double) (monotonic_ns() - begin) / 1e6;
+    if (!handle) {
+        LOGI("libil2cpp.so not found in thread %d after %.0f ms", gettid(), waited_ms);
+        return;
+    }
+    if (latency_ns) {
+        LOGI("libil2cpp.so loaded after %.1f ms, detected %.3f ms after dlopen", waited_ms,
+             (double) latency_ns / 1e6);
+    } else {
+        LOGI("libil2cpp.so found after %.1f ms", waited_ms);
     }
+    il2cpp_api_init(handle, game_data_dir);
+    il2cpp_dump(game_data_dir, config);
 }
 
 std::string GetLibDir(JavaVM *vms) {
@@ -111,7 +119,7 @@ struct NativeBridgeCallbacks {
     void *(*loadLibraryExt)(const char *libpath, int flag, void *ns);
 };
 
-bool NativeBridgeLoad(const char *game_data_dir, int api_level, void *data, size_t length) {
+bool NativeBridgeLoad(const char *game_data_dir, const char *dump_filter, int api_level, void *data, size_t length) {
     //TODO 等待houdini初始化
     sleep(5);
 
@@ -177,7 +185,9 @@ bool NativeBridgeLoad(const char *game_data_dir, int api_level, void *data, size
                                                                                   "JNI_OnLoad",
                                                                                   nullptr, 0);
                 LOGI("JNI_OnLoad %p", init);
-                init(vms, (void *) game_data_dir);
+                // only read during JNI_OnLoad, which copies the pointers
+                HackArgs args{game_data_dir, dump_filter};
+                init(vms, &args);
                 return true;
             }
             close(fd);
@@ -186,15 +196,15 @@ bool NativeBridgeLoad(const char *game_data_dir, int api_level, void *data, size
     return false;
 }
 
-void hack_prepare(const char *game_data_dir, void *data, size_t length) {
+void hack_prepare(const char *game_data_dir, const char *dump_filter, void *data, size_t length) {
     LOGI("hack thread: %d", gettid());
     int api_level = android_get_device_api_level();
     LOGI("api level: %d", api_level);
 
 #if defined(__i386__) || defined(__x86_64__)
-    if (!NativeBridgeLoad(game_data_dir, api_level, data, length)) {
+    if (!NativeBridgeLoad(game_data_dir, dump_filter, api_level, data, length)) {
 #endif
-        hack_start(game_data_dir);
+        hack_start(game_data_dir, dump_filter);
 #if defined(__i386__) || defined(__x86_64__)
     }
 #endif
@@ -203,8 +213,8 @@ void hack_prepare(const char *game_data_dir, void *data, size_t length) {
 #if defined(__arm__) || defined(__aarch64__)
 
 JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
-    auto game_data_dir = (const char *) reserved;
-    std::thread hack_thread(hack_start, game_data_dir);
+    auto args = (const HackArgs *) reserved;
+    std::thread hack_thread(hack_start, args->game_data_dir, args->dump_filter);
     hack_thread.detach();
     return JNI_VERSION_1_6;
 }
@@ -7,6 +7,13 @@
 
 #include <stddef.h>
 
-void hack_prepare(const char *game_data_dir, void *data, size_t length);
+// what the x86 library hands to the arm one through JNI_OnLoad's reserved pointer
+struct HackArgs {
+    const char *game_data_dir;
+    // contents of dump_filter.conf, nullptr without one
+    const char *dump_filter;
+};
+
+void hack_prepare(const char *game_data_dir, const char *dump_filter, void *data, size_t length);
 
 #endif //ZYGISK_IL2CPPDUMPER_HACK_H
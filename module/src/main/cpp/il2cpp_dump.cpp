@@ -7,12 +7,28 @@
 #include <cstdlib>
 #include <cstring>
 #include <cinttypes>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
-#include <sstream>
-#include <fstream>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include "xdl.h"
+#include "text_builder.h"
+#include "dump_format.h"
+#include "binary_dump_writer.h"
+#include "api_cache.h"
+#include "dump_manifest.h"
+#include "gzip_writer.h"
+#include "async_file_writer.h"
+#include "dump_stats.h"
+#include "pointer_cache.h"
 #include "log.h"
 #include "il2cpp-tabledefs.h"
 #include "il2cpp-class.h"
@@ -24,64 +40,109 @@
 #undef DO_API
 
 static uint64_t il2cpp_base = 0;
+// NT_GNU_BUILD_ID of libil2cpp.so, empty when it has none
+static std::string il2cpp_build_id;
+// measured by il2cpp_api_init, reported with the stats of the dump that follows
+static uint64_t api_bind_ns = 0;
+static uint64_t vm_wait_ns = 0;
 
-void init_il2cpp_api(void *handle) {
-#define DO_API(r, n, p) {                      \
-    n = (r (*) p)xdl_sym(handle, #n, nullptr); \
-    if(!n) {                                   \
-        LOGW("api not found %s", #n);          \
-    }                                          \
+// when il2cpp_init returned, as reported by its hook or seen by polling, 0 until then
+static std::mutex vm_mutex;
+static std::condition_variable vm_ready_changed;
+static bool vm_hooked = false;
+static uint64_t vm_ready_ns = 0;
+static bool vm_ready_polled = false;
+// only the first dump after il2cpp_init reports how soon it rendered a class
+static bool first_class_reported = false;
+
+// offsets from a previous launch, when they were taken from this very build and api list
+static bool load_api_cache(const char *path, const std::string &build_id, const xdl_info_t &info,
+                           const std::vector<const char *> &names, std::vector<void *> &addrs) {
+    ApiCache cache;
+    if (!cache.load(path)) {
+        return false;
+    }
+    auto stale = cache.build_id != build_id || cache.names.size() != names.size();
+    for (size_t i = 0; !stale && i < names.size(); ++i) {
+        auto offset = cache.offsets[i];
+        stale = cache.names[i] != names[i] || (offset && !is_code_offset(info.dlpi_phdr, info.dlpi_phnum, offset));
+    }
+    if (stale) {
+        LOGI("api cache %s is stale, rebuilding it", path);
+        return false;
+    }
+    for (size_t i = 0; i < names.size(); ++i) {
+        addrs[i] = cache.offsets[i] ? (void *) ((uintptr_t) info.dli_fbase + cache.offsets[i]) : nullptr;
+    }
+    return true;
+}
+
+static void save_api_cache(const char *path, const std::string &build_id, const xdl_info_t &info,
+                           const std::vector<const char *> &names, const std::vector<void *> &addrs) {
+    ApiCache cache;
+    cache.build_id = build_id;
+    for (size_t i = 0; i < names.size(); ++i) {
+        cache.names.emplace_back(names[i]);
+        cache.offsets.push_back(addrs[i] ? (uintptr_t) addrs[i] - (uintptr_t) info.dli_fbase : 0);
+    }
+    cache.save(path);
 }
 
+void init_il2cpp_api(void *handle, const char *cache_path) {
+    std::vector<const char *> names;
+#define DO_API(r, n, p) names.push_back(#n)
+
 #include "il2cpp-api-functions.h"
 
 #undef DO_API
-}
+    std::vector<void *> addrs(names.size());
+    xdl_info_t info{};
+    xdl_info(handle, XDL_DI_DLINFO, &info);
+    auto build_id = read_build_id((uintptr_t) info.dli_fbase, info.dlpi_phdr, info.dlpi_phnum);
+    il2cpp_build_id = build_id;
+    if (cache_path && !build_id.empty() && load_api_cache(cache_path, build_id, info, names, addrs)) {
+        LOGI("il2cpp api bound from %s", cache_path);
+    } else {
+        // one pass over .gnu.hash for the whole api
+        std::vector<uint64_t> missing((names.size() + 63) / 64);
+        auto found = xdl_sym_batch(handle, names.data(), names.size(), addrs.data(), nullptr, missing.data());
+        // builds that hide their exports may still carry them in .symtab
+        for (size_t i = 0; found < names.size() && i < names.size(); ++i) {
+            if (missing[i / 64] & (uint64_t) 1 << (i % 64)) {
+                addrs[i] = xdl_dsym(handle, names[i], nullptr);
+                found += addrs[i] != nullptr;
+            }
+        }
+        if (cache_path && !build_id.empty() && found > 0) {
+            save_api_cache(cache_path, build_id, info, names, addrs);
+        }
+    }
+    size_t i = 0;
+#define DO_API(r, n, p) n = (r (*) p)addrs[i++]
 
-std::string get_method_modifier(uint32_t flags) {
-    std::stringstream outPut;
-    auto access = flags & METHOD_ATTRIBUTE_MEMBER_ACCESS_MASK;
-    switch (access) {
-        case METHOD_ATTRIBUTE_PRIVATE:
-            outPut << "private ";
-            break;
-        case METHOD_ATTRIBUTE_PUBLIC:
-            outPut << "public ";
-            break;
-        case METHOD_ATTRIBUTE_FAMILY:
-            outPut << "protected ";
-            break;
-        case METHOD_ATTRIBUTE_ASSEM:
-        case METHOD_ATTRIBUTE_FAM_AND_ASSEM:
-            outPut << "internal ";
-            break;
-        case METHOD_ATTRIBUTE_FAM_OR_ASSEM:
-            outPut << "protected internal ";
-            break;
+#include "il2cpp-api-functions.h"
+
+#undef DO_API
+    // apis differ between Unity versions, so some are always missing: the count on one line, the
+    // names in chunks that stay well below what logcat keeps of a line (~4 KB)
+    size_t missing_count = 0;
+    for (i = 0; i < names.size(); ++i) {
+        missing_count += !addrs[i];
     }
-    if (flags & METHOD_ATTRIBUTE_STATIC) {
-        outPut << "static ";
+    if (!missing_count) {
+        return;
     }
-    if (flags & METHOD_ATTRIBUTE_ABSTRACT) {
-        outPut << "abstract ";
-        if ((flags & METHOD_ATTRIBUTE_VTABLE_LAYOUT_MASK) == METHOD_ATTRIBUTE_REUSE_SLOT) {
-            outPut << "override ";
+    LOGW("%zu of %zu apis not found", missing_count, names.size());
+    std::string missing_names;
+    for (i = 0; i < names.size(); ++i) {
+        if (!addrs[i]) {
+            missing_names.append(missing_names.empty() ? "" : ", ").append(names[i]);
         }
-    } else if (flags & METHOD_ATTRIBUTE_FINAL) {
-        if ((flags & METHOD_ATTRIBUTE_VTABLE_LAYOUT_MASK) == METHOD_ATTRIBUTE_REUSE_SLOT) {
-            outPut << "sealed override ";
+        if (!missing_names.empty() && (missing_names.size() >= 1024 || i + 1 == names.size())) {
+            LOGW("apis not found: %s", missing_names.c_str());
+            missing_names.clear();
         }
-    } else if (flags & METHOD_ATTRIBUTE_VIRTUAL) {
-        if ((flags & METHOD_ATTRIBUTE_VTABLE_LAYOUT_MASK) == METHOD_ATTRIBUTE_NEW_SLOT) {
-            outPut << "virtual ";
-        } else {
-            outPut << "override ";
-        }
-    }
-    if (flags & METHOD_ATTRIBUTE_PINVOKE_IMPL) {
-        outPut << "extern ";
     }
-    return outPut.str();
 }
 
 bool _il2cpp_type_is_byref(const Il2CppType *type) {
@@ -92,92 +153,111 @@ bool _il2cpp_type_is_byref(const Il2CppType *type) {
     return byref;
 }
 
-std::string dump_method(Il2CppClass *klass) {
-    std::stringstream outPut;
+// resolved once per Il2CppType/Il2CppClass pointer for the whole dump
+struct ResolvedType {
+    Il2CppClass *klass;
+    std::string_view name;
+    bool byref;
+};
+
+struct NameCache {
+    PointerCache<ResolvedType> types;
+    PointerCache<std::string_view> classes;
+
+    size_t hits() const {
+        return types.hits() + classes.hits();
+    }
+
+    size_t lookups() const {
+        return hits() + types.misses() + classes.misses();
+    }
+};
+
+std::string_view get_class_name(NameCache &cache, Il2CppClass *klass) {
+    bool inserted;
+    auto &name = cache.classes.find_or_insert(klass, inserted);
+    if (inserted) {
+        auto str = il2cpp_class_get_name(klass);
+        name = str ? std::string_view(str) : std::string_view();
+    }
+    return name;
+}
+
+ResolvedType resolve_type(NameCache &cache, const Il2CppType *type) {
+    bool inserted;
+    auto &resolved = cache.types.find_or_insert(type, inserted);
+    if (inserted) {
+        resolved.byref = _il2cpp_type_is_byref(type);
+        resolved.klass = il2cpp_class_from_type(type);
+        if (resolved.klass) {
+            resolved.name = get_class_name(cache, resolved.klass);
+        }
+    }
+    return resolved;
+}
+
+void dump_method(TextBuilder &outPut, NameCache &cache, DumpCounters &counters, Il2CppClass *klass) {
     outPut << "\n\t// Methods\n";
     void *iter = nullptr;
     while (auto method = il2cpp_class_get_methods(klass, &iter)) {
+        ++counters.methods;
         //TODO attribute
-        if (method->methodPointer) {
-            outPut << "\t// RVA: 0x";
-            outPut << std::hex << (uint64_t) method->methodPointer - il2cpp_base;
-            outPut << " VA: 0x";
-            outPut << std::hex << (uint64_t) method->methodPointer;
-        } else {
-            outPut << "\t// RVA: 0x VA: 0x0";
-        }
+        auto va = (uint64_t) method->methodPointer;
+        dump_method_address(outPut, va - il2cpp_base, va);
         /*if (method->slot != 65535) {
-            outPut << " Slot: " << std::dec << method->slot;
+            outPut << " Slot: ";
+            outPut.append_dec(method->slot);
         }*/
         outPut << "\n\t";
         uint32_t iflags = 0;
         auto flags = il2cpp_method_get_flags(method, &iflags);
-        outPut << get_method_modifier(flags);
+        dump_method_modifier(outPut, flags);
         //TODO genericContainerIndex
-        auto return_type = il2cpp_method_get_return_type(method);
-        if (_il2cpp_type_is_byref(return_type)) {
+        auto return_type = resolve_type(cache, il2cpp_method_get_return_type(method));
+        if (return_type.byref) {
             outPut << "ref ";
         }
-        auto return_class = il2cpp_class_from_type(return_type);
-        outPut << il2cpp_class_get_name(return_class) << " " << il2cpp_method_get_name(method)
-               << "(";
+        outPut << return_type.name << " " << il2cpp_method_get_name(method) << "(";
         auto param_count = il2cpp_method_get_param_count(method);
         for (int i = 0; i < param_count; ++i) {
             auto param = il2cpp_method_get_param(method, i);
             auto attrs = param->attrs;
-            if (_il2cpp_type_is_byref(param)) {
-                if (attrs & PARAM_ATTRIBUTE_OUT && !(attrs & PARAM_ATTRIBUTE_IN)) {
-                    outPut << "out ";
-                } else if (attrs & PARAM_ATTRIBUTE_IN && !(attrs & PARAM_ATTRIBUTE_OUT)) {
-                    outPut << "in ";
-                } else {
-                    outPut << "ref ";
-                }
-            } else {
-                if (attrs & PARAM_ATTRIBUTE_IN) {
-                    outPut << "[In] ";
-                }
-                if (attrs & PARAM_ATTRIBUTE_OUT) {
-                    outPut << "[Out] ";
-                }
-            }
-            auto parameter_class = il2cpp_class_from_type(param);
-            outPut << il2cpp_class_get_name(parameter_class) << " "
-                   << il2cpp_method_get_param_name(method, i);
+            auto parameter_type = resolve_type(cache, param);
+            dump_param_modifier(outPut, attrs, parameter_type.byref);
+            outPut << parameter_type.name << " " << il2cpp_method_get_param_name(method, i);
             outPut << ", ";
         }
         if (param_count > 0) {
-            outPut.seekp(-2, outPut.cur);
+            outPut.unappend(2);
         }
         outPut << ") { }\n";
         //TODO GenericInstMethod
     }
-    return outPut.str();
 }
 
-std::string dump_property(Il2CppClass *klass) {
-    std::stringstream outPut;
+void dump_property(TextBuilder &outPut, NameCache &cache, DumpCounters &counters, Il2CppClass *klass) {
     outPut << "\n\t// Properties\n";
     void *iter = nullptr;
     while (auto prop_const = il2cpp_class_get_properties(klass, &iter)) {
+        ++counters.properties;
         //TODO attribute
         auto prop = const_cast<PropertyInfo *>(prop_const);
         auto get = il2cpp_property_get_get_method(prop);
         auto set = il2cpp_property_get_set_method(prop);
         auto prop_name = il2cpp_property_get_name(prop);
         outPut << "\t";
-        Il2CppClass *prop_class = nullptr;
+        ResolvedType prop_type{};
         uint32_t iflags = 0;
         if (get) {
-            outPut << get_method_modifier(il2cpp_method_get_flags(get, &iflags));
-            prop_class = il2cpp_class_from_type(il2cpp_method_get_return_type(get));
+            dump_method_modifier(outPut, il2cpp_method_get_flags(get, &iflags));
+            prop_type = resolve_type(cache, il2cpp_method_get_return_type(get));
         } else if (set) {
-            outPut << get_method_modifier(il2cpp_method_get_flags(set, &iflags));
+            dump_method_modifier(outPut, il2cpp_method_get_flags(set, &iflags));
             auto param = il2cpp_method_get_param(set, 0);
-            prop_class = il2cpp_class_from_type(param);
+            prop_type = resolve_type(cache, param);
         }
-        if (prop_class) {
-            outPut << il2cpp_class_get_name(prop_class) << " " << prop_name << " { ";
+        if (prop_type.klass) {
+            outPut << prop_type.name << " " << prop_name << " { ";
             if (get) {
                 outPut << "get; ";
             }
@@ -191,64 +271,36 @@ std::string dump_property(Il2CppClass *klass) {
             }
         }
     }
-    return outPut.str();
 }
 
-std::string dump_field(Il2CppClass *klass) {
-    std::stringstream outPut;
+void dump_field(TextBuilder &outPut, NameCache &cache, DumpCounters &counters, Il2CppClass *klass) {
     outPut << "\n\t// Fields\n";
     auto is_enum = il2cpp_class_is_enum(klass);
     void *iter = nullptr;
     while (auto field = il2cpp_class_get_fields(klass, &iter)) {
+        ++counters.fields;
         //TODO attribute
         outPut << "\t";
         auto attrs = il2cpp_field_get_flags(field);
-        auto access = attrs & FIELD_ATTRIBUTE_FIELD_ACCESS_MASK;
-        switch (access) {
-            case FIELD_ATTRIBUTE_PRIVATE:
-                outPut << "private ";
-                break;
-            case FIELD_ATTRIBUTE_PUBLIC:
-                outPut << "public ";
-                break;
-            case FIELD_ATTRIBUTE_FAMILY:
-                outPut << "protected ";
-                break;
-            case FIELD_ATTRIBUTE_ASSEMBLY:
-            case FIELD_ATTRIBUTE_FAM_AND_ASSEM:
-                outPut << "internal ";
-                break;
-            case FIELD_ATTRIBUTE_FAM_OR_ASSEM:
-                outPut << "protected internal ";
-                break;
-        }
-        if (attrs & FIELD_ATTRIBUTE_LITERAL) {
-            outPut << "const ";
-        } else {
-            if (attrs & FIELD_ATTRIBUTE_STATIC) {
-                outPut << "static ";
-            }
-            if (attrs & FIELD_ATTRIBUTE_INIT_ONLY) {
-                outPut << "readonly ";
-            }
-        }
-        auto field_type = il2cpp_field_get_type(field);
-        auto field_class = il2cpp_class_from_type(field_type);
-        outPut << il2cpp_class_get_name(field_class) << " " << il2cpp_field_get_name(field);
+        dump_field_modifier(outPut, attrs);
+        auto field_type = resolve_type(cache, il2cpp_field_get_type(field));
+        outPut << field_type.name << " " << il2cpp_field_get_name(field);
         //TODO 获取构造函数初始化后的字段值
         if (attrs & FIELD_ATTRIBUTE_LITERAL && is_enum) {
             uint64_t val = 0;
             il2cpp_field_static_get_value(field, &val);
-            outPut << " = " << std::dec << val;
+            outPut << " = ";
+            outPut.append_dec(val);
         }
-        outPut << "; // 0x" << std::hex << il2cpp_field_get_offset(field) << "\n";
+        outPut << "; // 0x";
+        outPut.append_hex(il2cpp_field_get_offset(field));
+        outPut << "\n";
     }
-    return outPut.str();
 }
 
-std::string dump_type(const Il2CppType *type) {
-    std::stringstream outPut;
+void dump_type(TextBuilder &outPut, NameCache &cache, DumpCounters &counters, const Il2CppType *type) {
     auto *klass = il2cpp_class_from_type(type);
+    ++counters.classes;
     outPut << "\n// Namespace: " << il2cpp_class_get_namespace(klass) << "\n";
     auto flags = il2cpp_class_get_flags(klass);
     if (flags & TYPE_ATTRIBUTE_SERIALIZABLE) {
@@ -257,74 +309,193 @@ std::string dump_type(const Il2CppType *type) {
     //TODO attribute
     auto is_valuetype = il2cpp_class_is_valuetype(klass);
     auto is_enum = il2cpp_class_is_enum(klass);
-    auto visibility = flags & TYPE_ATTRIBUTE_VISIBILITY_MASK;
-    switch (visibility) {
-        case TYPE_ATTRIBUTE_PUBLIC:
-        case TYPE_ATTRIBUTE_NESTED_PUBLIC:
-            outPut << "public ";
-            break;
-        case TYPE_ATTRIBUTE_NOT_PUBLIC:
-        case TYPE_ATTRIBUTE_NESTED_FAM_AND_ASSEM:
-        case TYPE_ATTRIBUTE_NESTED_ASSEMBLY:
-            outPut << "internal ";
-            break;
-        case TYPE_ATTRIBUTE_NESTED_PRIVATE:
-            outPut << "private ";
-            break;
-        case TYPE_ATTRIBUTE_NESTED_FAMILY:
-            outPut << "protected ";
-            break;
-        case TYPE_ATTRIBUTE_NESTED_FAM_OR_ASSEM:
-            outPut << "protected internal ";
-            break;
-    }
-    if (flags & TYPE_ATTRIBUTE_ABSTRACT && flags & TYPE_ATTRIBUTE_SEALED) {
-        outPut << "static ";
-    } else if (!(flags & TYPE_ATTRIBUTE_INTERFACE) && flags & TYPE_ATTRIBUTE_ABSTRACT) {
-        outPut << "abstract ";
-    } else if (!is_valuetype && !is_enum && flags & TYPE_ATTRIBUTE_SEALED) {
-        outPut << "sealed ";
-    }
-    if (flags & TYPE_ATTRIBUTE_INTERFACE) {
-        outPut << "interface ";
-    } else if (is_enum) {
-        outPut << "enum ";
-    } else if (is_valuetype) {
-        outPut << "struct ";
-    } else {
-        outPut << "class ";
-    }
+    dump_type_modifier(outPut, flags, is_valuetype, is_enum);
     outPut << il2cpp_class_get_name(klass); //TODO genericContainerIndex
-    std::vector<std::string> extends;
+    auto extends = " : ";
     auto parent = il2cpp_class_get_parent(klass);
     if (!is_valuetype && !is_enum && parent) {
         auto parent_type = il2cpp_class_get_type(parent);
         if (parent_type->type != IL2CPP_TYPE_OBJECT) {
-            extends.emplace_back(il2cpp_class_get_name(parent));
+            outPut << extends << get_class_name(cache, parent);
+            extends = ", ";
         }
     }
     void *iter = nullptr;
     while (auto itf = il2cpp_class_get_interfaces(klass, &iter)) {
-        extends.emplace_back(il2cpp_class_get_name(itf));
-    }
-    if (!extends.empty()) {
-        outPut << " : " << extends[0];
-        for (int i = 1; i < extends.size(); ++i) {
-            outPut << ", " << extends[i];
-        }
+        outPut << extends << get_class_name(cache, itf);
+        extends = ", ";
     }
     outPut << "\n{";
-    outPut << dump_field(klass);
-    outPut << dump_property(klass);
-    outPut << dump_method(klass);
+    dump_field(outPut, cache, counters, klass);
+    dump_property(outPut, cache, counters, klass);
+    dump_method(outPut, cache, counters, klass);
     //TODO EventInfo
     outPut << "}\n";
-    return outPut.str();
 }
 
-void il2cpp_api_init(void *handle) {
+// binary counterpart of dump_type, see dump_binary.h
+void collect_type(BinaryDumpChunk &out, NameCache &cache, DumpCounters &counters, uint32_t image,
+                  Il2CppClass *klass) {
+    ++counters.classes;
+    BinaryDumpType type{};
+    type.image = image;
+    type.namespaze = out.add_string(il2cpp_class_get_namespace(klass));
+    type.name = out.add_string(il2cpp_class_get_name(klass));
+    type.flags = il2cpp_class_get_flags(klass);
+    auto is_valuetype = il2cpp_class_is_valuetype(klass);
+    auto is_enum = il2cpp_class_is_enum(klass);
+    if (is_valuetype) {
+        type.kind |= BINARY_DUMP_TYPE_VALUETYPE;
+    }
+    if (is_enum) {
+        type.kind |= BINARY_DUMP_TYPE_ENUM;
+    }
+    type.extends_begin = out.extends.size();
+    auto parent = il2cpp_class_get_parent(klass);
+    if (!is_valuetype && !is_enum && parent) {
+        auto parent_type = il2cpp_class_get_type(parent);
+        if (parent_type->type != IL2CPP_TYPE_OBJECT) {
+            type.kind |= BINARY_DUMP_TYPE_HAS_PARENT;
+            out.extends.push_back(out.add_string(get_class_name(cache, parent)));
+        }
+    }
+    void *iter = nullptr;
+    while (auto itf = il2cpp_class_get_interfaces(klass, &iter)) {
+        out.extends.push_back(out.add_string(get_class_name(cache, itf)));
+    }
+    type.extends_count = out.extends.size() - type.extends_begin;
+
+    type.field_begin = out.fields.size();
+    iter = nullptr;
+    while (auto field = il2cpp_class_get_fields(klass, &iter)) {
+        BinaryDumpField record{};
+        record.flags = il2cpp_field_get_flags(field);
+        record.type = out.add_string(resolve_type(cache, il2cpp_field_get_type(field)).name);
+        record.name = out.add_string(il2cpp_field_get_name(field));
+        if (record.flags & FIELD_ATTRIBUTE_LITERAL && is_enum) {
+            il2cpp_field_static_get_value(field, &record.value);
+            record.bits |= BINARY_DUMP_FIELD_HAS_VALUE;
+        }
+        record.offset = il2cpp_field_get_offset(field);
+        out.fields.push_back(record);
+    }
+    type.field_count = out.fields.size() - type.field_begin;
+    counters.fields += type.field_count;
+
+    type.property_begin = out.properties.size();
+    iter = nullptr;
+    while (auto prop_const = il2cpp_class_get_properties(klass, &iter)) {
+        auto prop = const_cast<PropertyInfo *>(prop_const);
+        auto get = il2cpp_property_get_get_method(prop);
+        auto set = il2cpp_property_get_set_method(prop);
+        BinaryDumpProperty record{};
+        record.name = out.add_string(il2cpp_property_get_name(prop));
+        ResolvedType prop_type{};
+        uint32_t iflags = 0;
+        if (get) {
+            record.bits |= BINARY_DUMP_PROPERTY_GET;
+            record.flags = il2cpp_method_get_flags(get, &iflags);
+            prop_type = resolve_type(cache, il2cpp_method_get_return_type(get));
+        } else if (set) {
+            record.flags = il2cpp_method_get_flags(set, &iflags);
+            prop_type = resolve_type(cache, il2cpp_method_get_param(set, 0));
+        }
+        if (set) {
+            record.bits |= BINARY_DUMP_PROPERTY_SET;
+        }
+        if (prop_type.klass) {
+            record.type = out.add_string(prop_type.name);
+        } else {
+            record.type = kBinaryDumpNoString;
+            record.bits |= BINARY_DUMP_PROPERTY_UNKNOWN;
+        }
+        out.properties.push_back(record);
+    }
+    type.property_count = out.properties.size() - type.property_begin;
+    counters.properties += type.property_count;
+
+    type.method_begin = out.methods.size();
+    iter = nullptr;
+    while (auto method = il2cpp_class_get_methods(klass, &iter)) {
+        BinaryDumpMethod record{};
+        record.va = (uint64_t) method->methodPointer;
+        record.rva = record.va ? record.va - il2cpp_base : 0;
+        uint32_t iflags = 0;
+        record.flags = il2cpp_method_get_flags(method, &iflags);
+        auto return_type = resolve_type(cache, il2cpp_method_get_return_type(method));
+        if (return_type.byref) {
+            record.bits |= BINARY_DUMP_BYREF;
+        }
+        record.return_type = out.add_string(return_type.name);
+        record.name = out.add_string(il2cpp_method_get_name(method));
+        record.param_begin = out.params.size();
+        auto param_count = il2cpp_method_get_param_count(method);
+        for (int i = 0; i < param_count; ++i) {
+            auto param = il2cpp_method_get_param(method, i);
+            auto parameter_type = resolve_type(cache, param);
+            BinaryDumpParam param_record{};
+            param_record.attrs = param->attrs;
+            param_record.bits = parameter_type.byref ? BINARY_DUMP_BYREF : 0;
+            param_record.type = out.add_string(parameter_type.name);
+            param_record.name = out.add_string(il2cpp_method_get_param_name(method, i));
+            out.params.push_back(param_record);
+        }
+        record.param_count = out.params.size() - record.param_begin;
+        out.methods.push_back(record);
+    }
+    type.method_count = out.methods.size() - type.method_begin;
+    counters.methods += type.method_count;
+    out.types.push_back(type);
+}
+
+void il2cpp_vm_ready_hooked() {
+    std::lock_guard<std::mutex> lock(vm_mutex);
+    vm_hooked = true;
+}
+
+void il2cpp_vm_ready() {
+    {
+        std::lock_guard<std::mutex> lock(vm_mutex);
+        if (!vm_ready_ns) {
+            vm_ready_ns = monotonic_ns();
+        }
+    }
+    vm_ready_changed.notify_all();
+}
+
+// until il2cpp_init has returned; keeps polling il2cpp_is_vm_thread() every 100 ms even with the
+// hook in place, in case it never fires
+static void wait_for_vm() {
+    std::unique_lock<std::mutex> lock(vm_mutex);
+    auto logged = false;
+    while (!vm_ready_ns) {
+        lock.unlock();
+        auto ready = il2cpp_is_vm_thread(nullptr);
+        lock.lock();
+        if (ready) {
+            if (!vm_ready_ns) {
+                vm_ready_ns = monotonic_ns();
+                vm_ready_polled = true;
+            }
+            break;
+        }
+        if (!logged) {
+            LOGI("Waiting for il2cpp_init%s...", vm_hooked ? " or its hook" : "");
+            logged = true;
+        }
+        vm_ready_changed.wait_for(lock, std::chrono::milliseconds(100), [] { return vm_ready_ns != 0; });
+    }
+}
+
+void il2cpp_api_init(void *handle, const char *game_data_dir) {
     LOGI("il2cpp_handle: %p", handle);
-    init_il2cpp_api(handle);
+    auto begin = monotonic_ns();
+    // what xdl_dsym() extracts from a .gnu_debugdata is kept for the next launch, before any lookup
+    auto symtab_cache_dir = std::string(game_data_dir).append("/files/xdl_symtab");
+    xdl_set_symtab_cache_dir(symtab_cache_dir.c_str());
+    auto cache_path = std::string(game_data_dir).append("/files/il2cpp_api.cache");
+    init_il2cpp_api(handle, cache_path.c_str());
+    api_bind_ns = monotonic_ns() - begin;
     if (il2cpp_domain_get_assemblies) {
         Dl_info dlInfo;
         if (dladdr((void *) il2cpp_domain_get_assemblies, &dlInfo)) {
@@ -335,39 +506,322 @@ void il2cpp_api_init(void *handle) {
         LOGE("Failed to initialize il2cpp api.");
         return;
     }
-    while (!il2cpp_is_vm_thread(nullptr)) {
-        LOGI("Waiting for il2cpp_init...");
-        sleep(1);
-    }
+    begin = monotonic_ns();
+    wait_for_vm();
+    vm_wait_ns = monotonic_ns() - begin;
     auto domain = il2cpp_domain_get();
     il2cpp_thread_attach(domain);
 }
 
-void il2cpp_dump(const char *outDir) {
+struct DumpImage {
+    const Il2CppImage *image;
+    std::string header;
+    size_t class_count;
+    uint64_t fingerprint;
+    // left out by the image rules of the dump filter
+    bool skipped;
+    // classes left out by its namespace rules
+    size_t filtered;
+    // only filled when classes come from reflection
+    std::vector<Il2CppClass *> classes;
+};
+
+struct DumpChunk {
+    size_t image;
+    size_t begin;
+    size_t end;
+};
+
+static constexpr size_t kChunkClasses = 64;
+
+static int get_big_core_count() {
+    auto cpu_count = (int) sysconf(_SC_NPROCESSORS_CONF);
+    std::vector<long> max_freqs;
+    for (int i = 0; i < cpu_count; ++i) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", i);
+        auto fp = fopen(path, "re");
+        if (!fp) {
+            continue;
+        }
+        long freq = 0;
+        if (fscanf(fp, "%ld", &freq) == 1) {
+            max_freqs.push_back(freq);
+        }
+        fclose(fp);
+    }
+    if (max_freqs.empty()) {
+        return cpu_count > 0 ? cpu_count : 1;
+    }
+    // everything faster than the little cluster
+    auto little = *std::min_element(max_freqs.begin(), max_freqs.end());
+    auto big = (int) std::count_if(max_freqs.begin(), max_freqs.end(), [little](long freq) {
+        return freq > little;
+    });
+    return big > 0 ? big : (int) max_freqs.size();
+}
+
+static Il2CppClass *get_image_class(const DumpImage &image, size_t index) {
+    if (!image.classes.empty()) {
+        return image.classes[index];
+    }
+    return const_cast<Il2CppClass *>(il2cpp_image_get_class(image.image, index));
+}
+
+static uint64_t fingerprint_mix(uint64_t hash, uint64_t value) {
+    // FNV-1a over 64-bit words
+    return (hash ^ value) * 0x100000001b3ull;
+}
+
+// nested types report an empty namespace, they belong to the one of their outermost declaring type
+static const char *get_filter_namespace(Il2CppClass *klass) {
+    if (il2cpp_class_get_declaring_type) {
+        while (auto declaring = il2cpp_class_get_declaring_type(klass)) {
+            klass = declaring;
+        }
+    }
+    return il2cpp_class_get_namespace(klass);
+}
+
+// keeps the classes whose namespace the filter allows. Namespaces are shared metadata strings,
+// so each distinct pointer is matched against the patterns once.
+static size_t filter_namespaces(std::vector<DumpImage> &images, const DumpFilter &filter) {
+    PointerCache<bool> allowed(256);
+    size_t removed = 0;
+    for (auto &image: images) {
+        std::vector<Il2CppClass *> kept;
+        kept.reserve(image.class_count);
+        for (size_t j = 0; j < image.class_count; ++j) {
+            auto klass = get_image_class(image, j);
+            auto namespaze = get_filter_namespace(klass);
+            bool allow;
+            if (namespaze) {
+                bool inserted;
+                auto &cached = allowed.find_or_insert(namespaze, inserted);
+                if (inserted) {
+                    cached = filter.allows_namespace(namespaze);
+                }
+                allow = cached;
+            } else {
+                allow = filter.allows_namespace(namespaze);
+            }
+            if (allow) {
+                kept.push_back(klass);
+            }
+        }
+        image.filtered = image.class_count - kept.size();
+        removed += image.filtered;
+        image.classes = std::move(kept);
+        image.class_count = image.classes.size();
+    }
+    return removed;
+}
+
+// cheap stand-in for the rendered text of an image within one libil2cpp.so build: type tokens,
+// field layout, property counts and method RVAs
+static uint64_t fingerprint_image(const DumpImage &image) {
+    auto hash = 0xcbf29ce484222325ull;
+    for (auto name = il2cpp_image_get_name(image.image); name && *name; ++name) {
+        hash = fingerprint_mix(hash, (unsigned char) *name);
+    }
+    hash = fingerprint_mix(hash, image.class_count);
+    for (size_t j = 0; j < image.class_count; ++j) {
+        auto klass = get_image_class(image, j);
+        hash = fingerprint_mix(hash, il2cpp_class_get_type_token(klass));
+        void *iter = nullptr;
+        while (auto field = il2cpp_class_get_fields(klass, &iter)) {
+            hash = fingerprint_mix(hash, (uint64_t) il2cpp_field_get_offset(field) << 32 | il2cpp_field_get_flags(field));
+        }
+        uint64_t property_count = 0;
+        iter = nullptr;
+        while (il2cpp_class_get_properties(klass, &iter)) {
+            ++property_count;
+        }
+        hash = fingerprint_mix(hash, property_count);
+        iter = nullptr;
+        while (auto method = il2cpp_class_get_methods(klass, &iter)) {
+            auto va = (uint64_t) method->methodPointer;
+            hash = fingerprint_mix(hash, va ? va - il2cpp_base : 0);
+        }
+    }
+    return hash;
+}
+
+// what a worker produced for one chunk, only the part matching the dump format is used
+struct ChunkOutput {
+    TextBuilder text;
+    BinaryDumpChunk binary;
+    DumpCounters counters;
+    // only measured when stats are enabled
+    uint64_t render_ns = 0;
+
+    void clear() {
+        text.clear();
+        binary.clear();
+        counters = {};
+        render_ns = 0;
+    }
+
+    void swap(ChunkOutput &other) {
+        text.swap(other.text);
+        binary.swap(other.binary);
+        std::swap(counters, other.counters);
+        std::swap(render_ns, other.render_ns);
+    }
+};
+
+static void dump_chunk(const std::vector<DumpImage> &images, const DumpChunk &chunk, const DumpConfig &config,
+                       NameCache &cache, ChunkOutput &output) {
+    auto begin = config.stats ? monotonic_ns() : 0;
+    auto &image = images[chunk.image];
+    for (auto j = chunk.begin; j < chunk.end; ++j) {
+        auto klass = get_image_class(image, j);
+        if (config.format == DumpFormat::Binary) {
+            collect_type(output.binary, cache, output.counters, chunk.image, klass);
+            continue;
+        }
+        auto type = il2cpp_class_get_type(klass);
+        //LOGD("type name : %s", il2cpp_type_get_name(type));
+        output.text << image.header;
+        dump_type(output.text, cache, output.counters, type);
+    }
+    if (config.stats) {
+        output.render_ns = monotonic_ns() - begin;
+    }
+}
+
+// renders `chunks` and hands the results to `consume` on the calling thread, in order
+static void dump_chunks(const std::vector<DumpImage> &images, const std::vector<DumpChunk> &chunks,
+                        int worker_count, const DumpConfig &config,
+                        const std::function<void(const DumpChunk &, const ChunkOutput &)> &consume) {
+    size_t cache_hits = 0;
+    size_t cache_lookups = 0;
+    auto report_cache = [&]() {
+        LOGI("name cache: %zu lookups, %zu hits (%.1f%%)", cache_lookups, cache_hits,
+             cache_lookups ? 100.0 * (double) cache_hits / (double) cache_lookups : 0.0);
+    };
+    if (worker_count <= 1 || chunks.size() <= 1) {
+        NameCache cache;
+        ChunkOutput output;
+        for (auto &chunk: chunks) {
+            output.clear();
+            dump_chunk(images, chunk, config, cache, output);
+            consume(chunk, output);
+        }
+        cache_hits = cache.hits();
+        cache_lookups = cache.lookups();
+        report_cache();
+        return;
+    }
+    // workers render chunks out of order into a ring of slots, this thread writes them in order.
+    // a worker never runs more than `window` chunks ahead of the writer, which bounds memory.
+    auto window = (size_t) worker_count * 4;
+    std::vector<ChunkOutput> slots(window);
+    std::vector<bool> ready(window);
+    size_t next = 0;
+    size_t written = 0;
+    std::mutex mutex;
+    std::condition_variable chunk_ready;
+    std::condition_variable slot_free;
+    auto domain = il2cpp_domain_get();
+    auto worker = [&]() {
+        auto thread = il2cpp_thread_attach(domain);
+        NameCache cache;
+        ChunkOutput output;
+        while (true) {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                slot_free.wait(lock, [&] {
+                    return next >= chunks.size() || next < written + window;
+                });
+                if (next >= chunks.size()) {
+                    break;
+                }
+                index = next++;
+            }
+            output.clear();
+            dump_chunk(images, chunks[index], config, cache, output);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                // hand over the rendered chunk and take back the slot's drained buffers
+                slots[index % window].swap(output);
+                ready[index % window] = true;
+            }
+            chunk_ready.notify_one();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cache_hits += cache.hits();
+            cache_lookups += cache.lookups();
+        }
+        if (il2cpp_thread_detach) {
+            il2cpp_thread_detach(thread);
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(worker_count);
+    for (int i = 0; i < worker_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (size_t index = 0; index < chunks.size(); ++index) {
+        auto slot = index % window;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            chunk_ready.wait(lock, [&] { return ready[slot]; });
+        }
+        // no worker touches this slot again until `written` moves past it
+        consume(chunks[index], slots[slot]);
+        slots[slot].clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready[slot] = false;
+            written = index + 1;
+        }
+        slot_free.notify_all();
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    report_cache();
+}
+
+void il2cpp_dump(const char *outDir, const DumpConfig &config) {
     LOGI("dumping...");
+    auto binary = config.format == DumpFormat::Binary;
+    auto compress = !binary && config.gzip_level > 0;
+    // fragments can only be copied out of an uncompressed dump.cs
+    auto incremental = !binary && !compress && config.incremental;
+    auto outPath = std::string(outDir).append(binary ? "/files/dump.bin" :
+                                              compress ? "/files/dump.cs.gz" : "/files/dump.cs");
+    auto manifestPath = std::string(outDir).append("/files/dump.manifest");
+    DumpStats stats(config.stats);
+    stats.format = binary ? "binary" : "text";
+    stats.gzip_level = compress ? config.gzip_level : 0;
+    stats.add_phase("api_bind", api_bind_ns);
+    stats.add_phase("vm_wait", vm_wait_ns);
+    stats.phase("enumerate");
     size_t size;
     auto domain = il2cpp_domain_get();
     auto assemblies = il2cpp_domain_get_assemblies(domain, &size);
-    std::stringstream imageOutput;
+    std::vector<DumpImage> images(size);
+    size_t skipped_count = 0;
     for (int i = 0; i < size; ++i) {
         auto image = il2cpp_assembly_get_image(assemblies[i]);
-        imageOutput << "// Image " << i << ": " << il2cpp_image_get_name(image) << "\n";
+        auto image_name = il2cpp_image_get_name(image);
+        images[i].image = image;
+        images[i].header = std::string("\n// Dll : ").append(image_name);
+        images[i].class_count = 0;
+        images[i].skipped = !config.filter.allows_image(image_name);
+        images[i].filtered = 0;
+        skipped_count += images[i].skipped;
     }
-    std::vector<std::string> outPuts;
     if (il2cpp_image_get_class) {
         LOGI("Version greater than 2018.3");
         //使用il2cpp_image_get_class
-        for (int i = 0; i < size; ++i) {
-            auto image = il2cpp_assembly_get_image(assemblies[i]);
-            std::stringstream imageStr;
-            imageStr << "\n// Dll : " << il2cpp_image_get_name(image);
-            auto classCount = il2cpp_image_get_class_count(image);
-            for (int j = 0; j < classCount; ++j) {
-                auto klass = il2cpp_image_get_class(image, j);
-                auto type = il2cpp_class_get_type(const_cast<Il2CppClass *>(klass));
-                //LOGD("type name : %s", il2cpp_type_get_name(type));
-                auto outPut = imageStr.str() + dump_type(type);
-                outPuts.push_back(outPut);
+        for (auto &image: images) {
+            if (!image.skipped) {
+                image.class_count = il2cpp_image_get_class_count(image.image);
             }
         }
     } else {
@@ -391,11 +845,11 @@ void il2cpp_dump(const char *outDir) {
         }
         typedef void *(*Assembly_Load_ftn)(void *, Il2CppString *, void *);
         typedef Il2CppArray *(*Assembly_GetTypes_ftn)(void *, void *);
-        for (int i = 0; i < size; ++i) {
-            auto image = il2cpp_assembly_get_image(assemblies[i]);
-            std::stringstream imageStr;
-            auto image_name = il2cpp_image_get_name(image);
-            imageStr << "\n// Dll : " << image_name;
+        for (auto &image: images) {
+            if (image.skipped) {
+                continue;
+            }
+            auto image_name = il2cpp_image_get_name(image.image);
             //LOGD("image name : %s", image->name);
             auto imageName = std::string(image_name);
             auto pos = imageName.rfind('.');
@@ -407,23 +861,195 @@ void il2cpp_dump(const char *outDir) {
             auto reflectionTypes = ((Assembly_GetTypes_ftn) assemblyGetTypes->methodPointer)(
                     reflectionAssembly, nullptr);
             auto items = reflectionTypes->vector;
+            image.class_count = reflectionTypes->max_length;
+            image.classes.reserve(image.class_count);
             for (int j = 0; j < reflectionTypes->max_length; ++j) {
                 auto klass = il2cpp_class_from_system_type((Il2CppReflectionType *) items[j]);
-                auto type = il2cpp_class_get_type(klass);
-                //LOGD("type name : %s", il2cpp_type_get_name(type));
-                auto outPut = imageStr.str() + dump_type(type);
-                outPuts.push_back(outPut);
+                image.classes.push_back(klass);
             }
         }
     }
-    LOGI("write dump file");
-    auto outPath = std::string(outDir).append("/files/dump.cs");
-    std::ofstream outStream(outPath);
-    outStream << imageOutput.str();
-    auto count = outPuts.size();
-    for (int i = 0; i < count; ++i) {
-        outStream << outPuts[i];
+    if (!config.filter.empty()) {
+        auto filtered_count = config.filter.has_namespace_rules() ? filter_namespaces(images, config.filter) : 0;
+        LOGI("dump filter: skipped %zu of %zu images and %zu classes by namespace", skipped_count, images.size(),
+             filtered_count);
+    }
+    TextBuilder imageOutput;
+    for (size_t i = 0; i < images.size(); ++i) {
+        dump_image_line(imageOutput, i, il2cpp_image_get_name(images[i].image), images[i].skipped);
     }
-    outStream.close();
+    // images whose fragment of the previous dump.cs can be copied as is
+    DumpManifest previous;
+    std::vector<const ManifestImage *> reused(images.size());
+    size_t reused_count = 0;
+    int previous_fd = -1;
+    if (incremental) {
+        stats.phase("fingerprint");
+        for (auto &image: images) {
+            image.fingerprint = fingerprint_image(image);
+        }
+        // fragments are only trusted from a dump of the same libil2cpp.so build and filter rules,
+        // the fingerprints then only have to tell its images apart
+        auto usable = !il2cpp_build_id.empty() && previous.load(manifestPath.c_str());
+        if (il2cpp_build_id.empty()) {
+            LOGI("libil2cpp.so has no build id, dumping everything");
+        } else if (usable && (previous.build_id != il2cpp_build_id || previous.filter_hash != config.filter.hash())) {
+            LOGI("libil2cpp.so or the dump filter changed, dumping everything");
+            usable = false;
+        }
+        if (usable) {
+            previous_fd = open(outPath.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st{};
+            if (previous_fd >= 0 && (fstat(previous_fd, &st) != 0 || (uint64_t) st.st_size != previous.dump_size)) {
+                LOGW("dump.cs does not match its manifest, dumping everything");
+                close(previous_fd);
+                previous_fd = -1;
+            }
+        }
+        for (size_t i = 0; previous_fd >= 0 && i < images.size() && i < previous.images.size(); ++i) {
+            auto &old = previous.images[i];
+            auto image_name = il2cpp_image_get_name(images[i].image);
+            if (old.fingerprint == images[i].fingerprint && old.class_count == images[i].class_count &&
+                image_name && old.name == image_name) {
+                reused[i] = &old;
+                ++reused_count;
+            }
+        }
+        LOGI("incremental dump: %zu of %zu images unchanged", reused_count, images.size());
+    }
+    // text goes to a temporary file first, the previous dump.cs may still be read from
+    auto writePath = binary ? outPath : outPath + ".tmp";
+    std::unique_ptr<DumpSink> outStream;
+    if (compress) {
+        outStream = std::make_unique<GzipWriter>(std::make_unique<AsyncFileWriter>(config.sync_output),
+                                                 config.gzip_level);
+    } else {
+        outStream = std::make_unique<AsyncFileWriter>(config.sync_output);
+    }
+    BinaryDumpWriter binaryStream;
+    if (binary ? !binaryStream.open(writePath.c_str()) : !outStream->open(writePath.c_str())) {
+        if (previous_fd >= 0) {
+            close(previous_fd);
+        }
+        return;
+    }
+    if (!binary) {
+        outStream->write(imageOutput.view());
+    }
+    std::vector<DumpChunk> chunks;
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (binary) {
+            binaryStream.add_image(il2cpp_image_get_name(images[i].image), images[i].class_count,
+                                   images[i].skipped ? BINARY_DUMP_IMAGE_SKIPPED : 0);
+        }
+        if (reused[i]) {
+            continue;
+        }
+        for (size_t begin = 0; begin < images[i].class_count; begin += kChunkClasses) {
+            chunks.push_back({i, begin, std::min(begin + kChunkClasses, images[i].class_count)});
+        }
+    }
+    DumpManifest manifest;
+    manifest.build_id = il2cpp_build_id;
+    manifest.filter_hash = config.filter.hash();
+    manifest.il2cpp_base = il2cpp_base;
+    manifest.images.resize(images.size());
+    std::vector<bool> started(images.size());
+    size_t finished = 0;
+    auto copy_ok = true;
+    // closes the fragments of all images before `end`, copying the reused ones over
+    auto finish_images = [&](size_t end) {
+        for (; finished < end; ++finished) {
+            auto &entry = manifest.images[finished];
+            if (!started[finished]) {
+                entry.offset = outStream->size();
+                if (reused[finished]) {
+                    auto begin = stats.is_enabled() ? monotonic_ns() : 0;
+                    copy_ok = copy_ok && copy_manifest_image(previous_fd, *reused[finished], previous.il2cpp_base,
+                                                             il2cpp_base, *outStream);
+                    if (stats.is_enabled()) {
+                        stats.images[finished].render_ns = monotonic_ns() - begin;
+                    }
+                }
+            }
+            entry.length = outStream->size() - entry.offset;
+            auto image_name = il2cpp_image_get_name(images[finished].image);
+            entry.name = image_name ? image_name : "";
+            entry.class_count = images[finished].class_count;
+            entry.fingerprint = images[finished].fingerprint;
+        }
+    };
+    if (stats.is_enabled()) {
+        stats.images.resize(images.size());
+        for (size_t i = 0; i < images.size(); ++i) {
+            auto image_name = il2cpp_image_get_name(images[i].image);
+            stats.images[i].name = image_name ? image_name : "";
+            stats.images[i].classes = images[i].class_count;
+            stats.images[i].reused = reused[i] != nullptr;
+            stats.images[i].skipped = images[i].skipped;
+            stats.images[i].filtered = images[i].filtered;
+        }
+    }
+    auto worker_count = config.worker_count > 0 ? config.worker_count : get_big_core_count();
+    stats.workers = worker_count;
+    stats.phase("render");
+    LOGI("rendering %zu chunks with %d workers", chunks.size(), worker_count);
+    size_t consumed = 0;
+    dump_chunks(images, chunks, worker_count, config, [&](const DumpChunk &chunk, const ChunkOutput &output) {
+        if (!first_class_reported && vm_ready_ns && output.counters.classes) {
+            first_class_reported = true;
+            stats.first_class_ns = monotonic_ns() - vm_ready_ns;
+            LOGI("first class rendered %.3f ms after il2cpp_init %s", (double) stats.first_class_ns / 1e6,
+                 vm_ready_polled ? "was polled" : "returned");
+        }
+        stats.counters.add(output.counters);
+        if (stats.is_enabled()) {
+            stats.images[chunk.image].render_ns += output.render_ns;
+            if (++consumed % 64 == 0) {
+                stats.sample_rss();
+            }
+        }
+        if (binary) {
+            binaryStream.add_chunk(output.binary);
+            return;
+        }
+        finish_images(chunk.image);
+        if (!started[chunk.image]) {
+            started[chunk.image] = true;
+            manifest.images[chunk.image].offset = outStream->size();
+        }
+        outStream->write(output.text.view());
+    });
+    auto statsPath = std::string(outDir).append("/files/dump_stats.json");
+    if (binary) {
+        stats.phase("flush");
+        if (!binaryStream.close(il2cpp_base)) {
+            LOGE("failed to write %s", outPath.c_str());
+            return;
+        }
+        stats.bytes = binaryStream.size();
+        stats.write(statsPath.c_str());
+        LOGI("dump done!");
+        return;
+    }
+    finish_images(images.size());
+    if (previous_fd >= 0) {
+        close(previous_fd);
+    }
+    manifest.dump_size = outStream->size();
+    stats.bytes = manifest.dump_size;
+    stats.phase("flush");
+    if (!outStream->close() || !copy_ok || rename(writePath.c_str(), outPath.c_str()) != 0) {
+        LOGE("failed to write %s", outPath.c_str());
+        unlink(writePath.c_str());
+        return;
+    }
+    if (compress) {
+        // dump.cs and its manifest are left alone
+    } else if (!incremental || !manifest.save(manifestPath.c_str())) {
+        // a stale manifest must not describe the new dump.cs
+        unlink(manifestPath.c_str());
+    }
+    stats.write(statsPath.c_str());
     LOGI("dump done!");
-}
\ No newline at end of file
+}
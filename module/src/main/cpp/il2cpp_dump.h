@@ -5,8 +5,17 @@
 #ifndef ZYGISK_IL2CPPDUMPER_IL2CPP_DUMP_H
 #define ZYGISK_IL2CPPDUMPER_IL2CPP_DUMP_H
 
-void il2cpp_api_init(void *handle);
+#include "dump_config.h"
 
-void il2cpp_dump(const char *outDir);
+// binds the il2cpp api, through <game_data_dir>/files/il2cpp_api.cache when it matches the build
+void il2cpp_api_init(void *handle, const char *game_data_dir);
+
+// the il2cpp_init hook is in place, so il2cpp_api_init() is woken by it, polling stays as a fallback
+void il2cpp_vm_ready_hooked();
+
+// called by the il2cpp_init hook once il2cpp_init has returned
+void il2cpp_vm_ready();
+
+void il2cpp_dump(const char *outDir, const DumpConfig &config = {});
 
 #endif //ZYGISK_IL2CPPDUMPER_IL2CPP_DUMP_H
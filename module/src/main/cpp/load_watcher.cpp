@@ -0,0 +1,69 @@
+#include "load_watcher.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include "dump_stats.h"
+#include "xdl.h"
+
+// how often to look again when nothing was reported, with and without hooks
+static constexpr uint64_t kHookedPollNs = 1000000000;
+static constexpr uint64_t kPollNs = 100000000;
+
+static std::mutex watcher_mutex;
+static std::condition_variable watcher_loaded;
+static bool hooked = false;
+// bumped by every successful dlopen() the hooks see
+static uint64_t load_generation = 0;
+// when the last few generations were reported, generation g at [g % kLoadHistory]
+static constexpr uint64_t kLoadHistory = 64;
+static uint64_t load_ns[kLoadHistory];
+
+void load_watcher_set_hooked() {
+    std::lock_guard lock(watcher_mutex);
+    hooked = true;
+}
+
+void load_watcher_notify(void *handle) {
+    if (!handle) {
+        return;
+    }
+    {
+        std::lock_guard lock(watcher_mutex);
+        ++load_generation;
+        load_ns[load_generation % kLoadHistory] = monotonic_ns();
+    }
+    watcher_loaded.notify_all();
+}
+
+void *load_watcher_wait(const char *soname, uint32_t timeout_ms, uint64_t &latency_ns) {
+    latency_ns = 0;
+    auto deadline = timeout_ms ? monotonic_ns() + (uint64_t) timeout_ms * 1000000 : UINT64_MAX;
+    std::unique_lock lock(watcher_mutex);
+    // generation seen before the last look that did not find it: the loads up to it returned
+    // before that look, so the one that mapped `soname` is the first one after it
+    auto missed_generation = UINT64_MAX;
+    while (true) {
+        // a load reported while looking bumps the generation, so it is not slept through
+        auto generation = load_generation;
+        lock.unlock();
+        auto handle = xdl_open(soname, XDL_DEFAULT);
+        lock.lock();
+        auto now = monotonic_ns();
+        if (handle) {
+            if (missed_generation != UINT64_MAX && load_generation != missed_generation &&
+                load_generation - missed_generation <= kLoadHistory) {
+                latency_ns = now - load_ns[(missed_generation + 1) % kLoadHistory];
+            }
+            return handle;
+        }
+        missed_generation = generation;
+        if (now >= deadline) {
+            return nullptr;
+        }
+        auto wait_ns = std::min(hooked ? kHookedPollNs : kPollNs, deadline - now);
+        watcher_loaded.wait_for(lock, std::chrono::nanoseconds(wait_ns), [generation] {
+            return load_generation != generation;
+        });
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef ZYGISK_IL2CPPDUMPER_LOAD_WATCHER_H
+#define ZYGISK_IL2CPPDUMPER_LOAD_WATCHER_H
+
+#include <cstdint>
+
+// Wakes the threads waiting for a library when a dlopen() hook reports a load, instead of
+// polling for it once a second. Without hooks, or for loads they cannot see, waiting still
+// polls, just more often.
+
+// the hooks are in place, so waiting only polls as a safety net
+void load_watcher_set_hooked();
+
+// called by the hooks after every dlopen(), with what it returned
+void load_watcher_notify(void *handle);
+
+// xdl handle of `soname` once it is loaded, nullptr after `timeout_ms` (0 waits forever).
+// `latency_ns` gets the time from the dlopen() that loaded it to its detection, or 0 when it
+// was already loaded or no hook saw it load
+void *load_watcher_wait(const char *soname, uint32_t timeout_ms, uint64_t &latency_ns);
+
+#endif //ZYGISK_IL2CPPDUMPER_LOAD_WATCHER_H
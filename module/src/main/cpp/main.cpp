@@ -6,7 +6,11 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <cinttypes>
+#include <android/api-level.h>
+#include <android/dlext.h>
 #include "hack.h"
+#include "il2cpp_dump.h"
+#include "load_watcher.h"
 #include "zygisk.hpp"
 #include "game.h"
 #include "log.h"
@@ -15,6 +19,91 @@ using zygisk::Api;
 using zygisk::AppSpecializeArgs;
 using zygisk::ServerSpecializeArgs;
 
+// reads a small text file from the module directory, nullptr when it does not exist
+static char *read_module_file(int dirfd, const char *name) {
+    int fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return nullptr;
+    }
+    struct stat sb{};
+    char *text = nullptr;
+    if (fstat(fd, &sb) == 0) {
+        text = new char[sb.st_size + 1];
+        auto n = read(fd, text, sb.st_size);
+        text[n > 0 ? n : 0] = '\0';
+    }
+    close(fd);
+    return text;
+}
+
+// libdl forwards every dlopen() of the process to the linker through these, so libil2cpp.so is
+// seen as soon as it is loaded. The caller address is passed on, which keeps the caller's
+// linker namespace.
+static void *(*orig_loader_dlopen)(const char *, int, const void *) = nullptr;
+static void *(*orig_loader_android_dlopen_ext)(const char *, int, const android_dlextinfo *,
+                                               const void *) = nullptr;
+
+static void *loader_dlopen_hook(const char *filename, int flags, const void *caller_addr) {
+    auto handle = orig_loader_dlopen(filename, flags, caller_addr);
+    load_watcher_notify(handle);
+    return handle;
+}
+
+static void *loader_android_dlopen_ext_hook(const char *filename, int flags,
+                                            const android_dlextinfo *extinfo,
+                                            const void *caller_addr) {
+    auto handle = orig_loader_android_dlopen_ext(filename, flags, extinfo, caller_addr);
+    load_watcher_notify(handle);
+    return handle;
+}
+
+// Unity looks the il2cpp api up with dlsym(), so it can be handed an il2cpp_init that reports
+// when the VM is ready
+static void *(*orig_loader_dlsym)(void *, const char *, const void *) = nullptr;
+static int (*orig_il2cpp_init)(const char *) = nullptr;
+
+static int il2cpp_init_hook(const char *domain_name) {
+    auto result = orig_il2cpp_init(domain_name);
+    il2cpp_vm_ready();
+    return result;
+}
+
+static void *loader_dlsym_hook(void *handle, const char *symbol, const void *caller_addr) {
+    auto address = orig_loader_dlsym(handle, symbol, caller_addr);
+    if (address && symbol && strcmp(symbol, "il2cpp_init") == 0) {
+        orig_il2cpp_init = (int (*)(const char *)) address;
+        return (void *) il2cpp_init_hook;
+    }
+    return address;
+}
+
+static void hook_linker(Api *api) {
+    // before 8.0 the linker implements dlopen() itself and a hook would change the caller
+    // namespace, waiting for libil2cpp.so and il2cpp_init falls back to polling there
+    if (android_get_device_api_level() < __ANDROID_API_O__) {
+        return;
+    }
+    auto libdl = ".*/libdl\\.so$";
+    api->pltHookRegister(libdl, "__loader_dlopen", (void *) loader_dlopen_hook,
+                         (void **) &orig_loader_dlopen);
+    api->pltHookRegister(libdl, "__loader_android_dlopen_ext",
+                         (void *) loader_android_dlopen_ext_hook,
+                         (void **) &orig_loader_android_dlopen_ext);
+    api->pltHookRegister(libdl, "__loader_dlsym", (void *) loader_dlsym_hook, (void **) &orig_loader_dlsym);
+    // the arm libdl.so of a native bridge is not ours to patch
+    api->pltHookExclude(".*/arm(64)?/libdl\\.so$", nullptr);
+    if (!api->pltHookCommit()) {
+        LOGW("dlopen hooks not installed, polling for libil2cpp.so and il2cpp_init");
+        return;
+    }
+    if (orig_loader_dlopen && orig_loader_android_dlopen_ext) {
+        load_watcher_set_hooked();
+    }
+    if (orig_loader_dlsym) {
+        il2cpp_vm_ready_hooked();
+    }
+}
+
 class MyModule : public zygisk::ModuleBase {
 public:
     void onLoad(Api *api, JNIEnv *env) override {
@@ -32,7 +121,9 @@ public:
 
     void postAppSpecialize(const AppSpecializeArgs *) override {
         if (enable_hack) {
-            std::thread hack_thread(hack_prepare, game_data_dir, data, length);
+            // the api is only usable until this returns
+            hook_linker(api);
+            std::thread hack_thread(hack_prepare, game_data_dir, dump_filter, data, length);
             hack_thread.detach();
         }
     }
@@ -42,6 +133,7 @@ private:
     JNIEnv *env;
     bool enable_hack;
     char *game_data_dir;
+    char *dump_filter;
     void *data;
     size_t length;
 
@@ -52,6 +144,13 @@ private:
             game_data_dir = new char[strlen(app_data_dir) + 1];
             strcpy(game_data_dir, app_data_dir);
 
+            // the module directory is out of reach once the app is specialized
+            int dirfd = api->getModuleDir();
+            dump_filter = read_module_file(dirfd, "dump_filter.conf");
+            if (dump_filter) {
+                LOGI("dump filter loaded");
+            }
+
 #if defined(__i386__)
             auto path = "zygisk/armeabi-v7a.so";
 #endif
@@ -59,7 +158,6 @@ private:
             auto path = "zygisk/arm64-v8a.so";
 #endif
 #if defined(__i386__) || defined(__x86_64__)
-            int dirfd = api->getModuleDir();
             int fd = openat(dirfd, path, O_RDONLY);
             if (fd != -1) {
                 struct stat sb{};
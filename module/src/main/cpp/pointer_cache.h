@@ -0,0 +1,100 @@
+#ifndef ZYGISK_IL2CPPDUMPER_POINTER_CACHE_H
+#define ZYGISK_IL2CPPDUMPER_POINTER_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Open-addressing (linear probing) map from a runtime pointer to a memoized value.
+// Entries are never removed; the table doubles when it is half full. Not thread-safe,
+// every dump worker owns its own instance.
+template<class Value>
+class PointerCache {
+public:
+    explicit PointerCache(size_t capacity = 1024) {
+        auto size = (size_t) 16;
+        while (size < capacity * 2) {
+            size *= 2;
+        }
+        allocate(size);
+    }
+
+    PointerCache(const PointerCache &) = delete;
+
+    PointerCache &operator=(const PointerCache &) = delete;
+
+    // returns the value stored for `key`; `inserted` is set when the caller has to fill it in
+    Value &find_or_insert(const void *key, bool &inserted) {
+        auto index = find_slot(key);
+        if (slots[index].key == key) {
+            ++hit_count;
+            inserted = false;
+            return slots[index].value;
+        }
+        ++miss_count;
+        inserted = true;
+        if ((count + 1) * 2 > mask + 1) {
+            grow();
+            index = find_slot(key);
+        }
+        ++count;
+        slots[index].key = key;
+        slots[index].value = Value{};
+        return slots[index].value;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    size_t hits() const {
+        return hit_count;
+    }
+
+    size_t misses() const {
+        return miss_count;
+    }
+
+private:
+    struct Slot {
+        const void *key;
+        Value value;
+    };
+
+    static size_t hash(const void *key) {
+        // fibonacci hashing; keys may be unaligned (string pointers), so no low bits are dropped
+        return (size_t) ((uint64_t) (uintptr_t) key * 0x9E3779B97F4A7C15ull >> 32);
+    }
+
+    size_t find_slot(const void *key) const {
+        auto index = hash(key) & mask;
+        while (slots[index].key && slots[index].key != key) {
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    void allocate(size_t size) {
+        slots.reset(new Slot[size]());
+        mask = size - 1;
+    }
+
+    void grow() {
+        auto old_slots = std::move(slots);
+        auto old_size = mask + 1;
+        allocate(old_size * 2);
+        for (size_t i = 0; i < old_size; ++i) {
+            if (old_slots[i].key) {
+                slots[find_slot(old_slots[i].key)] = old_slots[i];
+            }
+        }
+    }
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask = 0;
+    size_t count = 0;
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+};
+
+#endif //ZYGISK_IL2CPPDUMPER_POINTER_CACHE_H
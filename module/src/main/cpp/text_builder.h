@@ -0,0 +1,151 @@
+#ifndef ZYGISK_IL2CPPDUMPER_TEXT_BUILDER_H
+#define ZYGISK_IL2CPPDUMPER_TEXT_BUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+// Append-only text buffer used by the dump renderer. The backing store only ever grows
+// and is kept across clear(), so a builder that is reused for every class stops
+// allocating once it has seen the largest class. Numbers are formatted by hand, without
+// iostreams or locales.
+class TextBuilder {
+public:
+    TextBuilder() = default;
+
+    explicit TextBuilder(size_t capacity) {
+        reserve(capacity);
+    }
+
+    ~TextBuilder() {
+        free(buffer);
+    }
+
+    TextBuilder(const TextBuilder &) = delete;
+
+    TextBuilder &operator=(const TextBuilder &) = delete;
+
+    TextBuilder(TextBuilder &&other) noexcept {
+        swap(other);
+    }
+
+    TextBuilder &operator=(TextBuilder &&other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    void swap(TextBuilder &other) noexcept {
+        std::swap(buffer, other.buffer);
+        std::swap(length, other.length);
+        std::swap(capacity, other.capacity);
+    }
+
+    const char *data() const {
+        return buffer;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    bool empty() const {
+        return length == 0;
+    }
+
+    std::string_view view() const {
+        return {buffer, length};
+    }
+
+    void clear() {
+        length = 0;
+    }
+
+    // drops the last `count` characters
+    void unappend(size_t count) {
+        length = count < length ? length - count : 0;
+    }
+
+    void reserve(size_t size) {
+        if (size <= capacity) {
+            return;
+        }
+        auto new_capacity = capacity ? capacity : 256;
+        while (new_capacity < size) {
+            new_capacity *= 2;
+        }
+        auto new_buffer = static_cast<char *>(realloc(buffer, new_capacity));
+        if (!new_buffer) {
+            abort();
+        }
+        buffer = new_buffer;
+        capacity = new_capacity;
+    }
+
+    TextBuilder &append(const char *str, size_t size) {
+        reserve(length + size);
+        memcpy(buffer + length, str, size);
+        length += size;
+        return *this;
+    }
+
+    TextBuilder &append(std::string_view str) {
+        return append(str.data(), str.size());
+    }
+
+    TextBuilder &append(const char *str) {
+        return str ? append(str, strlen(str)) : *this;
+    }
+
+    TextBuilder &append(char c) {
+        reserve(length + 1);
+        buffer[length++] = c;
+        return *this;
+    }
+
+    // same digits as `std::dec << value`
+    TextBuilder &append_dec(uint64_t value) {
+        char digits[20];
+        auto end = digits + sizeof(digits);
+        auto p = end;
+        do {
+            *--p = (char) ('0' + value % 10);
+            value /= 10;
+        } while (value);
+        return append(p, end - p);
+    }
+
+    // same digits as `std::hex << value`: lowercase, no prefix
+    TextBuilder &append_hex(uint64_t value) {
+        static constexpr char kHex[] = "0123456789abcdef";
+        char digits[16];
+        auto end = digits + sizeof(digits);
+        auto p = end;
+        do {
+            *--p = kHex[value & 0xf];
+            value >>= 4;
+        } while (value);
+        return append(p, end - p);
+    }
+
+    TextBuilder &operator<<(std::string_view str) {
+        return append(str);
+    }
+
+    TextBuilder &operator<<(const char *str) {
+        return append(str);
+    }
+
+    TextBuilder &operator<<(char c) {
+        return append(c);
+    }
+
+private:
+    char *buffer = nullptr;
+    size_t length = 0;
+    size_t capacity = 0;
+};
+
+#endif //ZYGISK_IL2CPPDUMPER_TEXT_BUILDER_H
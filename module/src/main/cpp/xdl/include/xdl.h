@@ -35,6 +35,7 @@
 #include <dlfcn.h>
 #include <link.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -52,6 +53,13 @@ typedef struct {
   size_t dlpi_phnum;            // Number of items in dlpi_phdr.
 } xdl_info_t;
 
+typedef struct {
+  size_t symtab_cnt;   // Number of entries in .symtab.
+  size_t indexed_cnt;  // Number of distinct exported names in the hash index used by xdl_dsym().
+  size_t index_sz;     // Bytes allocated for the hash index.
+  uint64_t build_ns;   // Time spent building the hash index.
+} xdl_symtab_index_info_t;
+
 //
 // Default value for flags in both xdl_open() and xdl_iterate_phdr().
 //
@@ -59,6 +67,9 @@ typedef struct {
 
 //
 // Enhanced dlopen() / dlclose() / dlsym().
+// xdl_open() takes a path, a trailing part of one ("arm64/libfoo.so") or a whole basename.
+// A handle may be used by several threads at once, the first lookups load its tables once and
+// later ones do not lock. xdl_close() must not race with lookups on the same handle.
 //
 #define XDL_TRY_FORCE_LOAD    0x01
 #define XDL_ALWAYS_FORCE_LOAD 0x02
@@ -67,22 +78,74 @@ void *xdl_close(void *handle);
 void *xdl_sym(void *handle, const char *symbol, size_t *symbol_size);
 void *xdl_dsym(void *handle, const char *symbol, size_t *symbol_size);
 
+//
+// xdl_open() for filenames[0..cnt), matching names exactly like it. The libraries that have to be
+// force loaded are all loaded before any of them is searched. Sets handles[i], NULL for the names
+// not found, and returns how many were opened.
+//
+size_t xdl_open_many(const char *const *filenames, size_t cnt, int flags, void **handles);
+
+//
+// xdl_sym() for names[0..cnt) in one pass over .gnu.hash. addrs[i] and, when not NULL, sizes[i]
+// are set for every name found. missing, when not NULL, holds (cnt + 63) / 64 words and gets bit
+// i % 64 of word i / 64 set for every name that is not. Returns the number of names found.
+//
+size_t xdl_sym_batch(void *handle, const char *const *names, size_t cnt, void **addrs, size_t *sizes,
+                     uint64_t *missing);
+
 //
 // Enhanced dladdr().
+// *cache must be NULL before the first call. It keeps every library seen, indexed by its
+// loaded segments, until xdl_addr_clean(). A cache belongs to one thread at a time.
+// When symbols overlap or alias, the first one in .dynsym, else in .symtab, is reported.
 //
 int xdl_addr(void *addr, xdl_info_t *info, void **cache);
 void xdl_addr_clean(void **cache);
 
+//
+// xdl_addr() for many addresses at once. Sorted addresses are resolved in a single pass over
+// each library's symbols, unsorted ones still work but lose that. Returns the number of
+// addresses whose library was found; infos[i] is zeroed for the others.
+//
+size_t xdl_addr_batch(void *const *addrs, xdl_info_t *infos, size_t cnt, void **cache);
+
+//
+// Calls callback for every defined symbol of .dynsym and/or .symtab, in table order, until it
+// returns non-zero. symbol and its name are only valid during the call, nothing is allocated per
+// symbol. A name may show up in both tables. Returns what callback returned last, or -1 when
+// none of the tables in flags could be loaded.
+//
+#define XDL_ITERATE_DYNSYM 0x01
+#define XDL_ITERATE_SYMTAB 0x02
+typedef struct {
+  const char *name;
+  void *addr;          // For STT_TLS, the offset in the TLS block of the ELF.
+  size_t size;
+  unsigned char type;  // STT_*
+  unsigned char bind;  // STB_*
+  int table;           // XDL_ITERATE_DYNSYM or XDL_ITERATE_SYMTAB
+} xdl_symbol_t;
+typedef int (*xdl_iterate_symbols_cb_t)(const xdl_symbol_t *symbol, void *arg);
+int xdl_iterate_symbols(void *handle, int flags, xdl_iterate_symbols_cb_t callback, void *arg);
+
 //
 // Enhanced dl_iterate_phdr().
 //
 #define XDL_FULL_PATHNAME 0x01
 int xdl_iterate_phdr(int (*callback)(struct dl_phdr_info *, size_t, void *), void *data, int flags);
 
+//
+// Keep the .symtab/.strtab that xdl_dsym() extracts from .gnu_debugdata (minidebuginfo) in dir,
+// one file per NT_GNU_BUILD_ID, and map them from there instead of decompressing again. NULL
+// turns it off, which is the default. Not thread-safe: call it before using any handle.
+//
+int xdl_set_symtab_cache_dir(const char *dir);
+
 //
 // Custom dlinfo().
 //
-#define XDL_DI_DLINFO 1  // type of info: xdl_info_t
+#define XDL_DI_DLINFO       1  // type of info: xdl_info_t
+#define XDL_DI_SYMTAB_INDEX 2  // type of info: xdl_symtab_index_info_t
 int xdl_info(void *handle, int request, void *info);
 
 #ifdef __cplusplus
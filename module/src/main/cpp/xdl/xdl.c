@@ -39,6 +39,7 @@
 #include <sys/prctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "xdl_iterate.h"
@@ -61,20 +62,44 @@ extern __attribute((weak)) unsigned long int getauxval(unsigned long int);
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wpadded"
 
+typedef struct {
+  uint32_t hash;  // GNU hash of the symbol name
+  uint32_t sym;   // index in .symtab + 1, 0 for an empty slot
+} xdl_symtab_slot_t;
+
+typedef struct {
+  ElfW(Addr) start;    // st_value
+  ElfW(Addr) end;      // st_value + st_size
+  ElfW(Addr) max_end;  // largest end of this and every entry before it
+  ElfW(Word) name;     // st_name
+  uint32_t sym;        // index in the symbol table, the first one wins among overlapping entries
+} xdl_addr_sym_t;
+
+// exported symbols of one table sorted by start address, built on the first xdl_addr() that needs it
+typedef struct {
+  bool try_build;  // set once built or given up on, see xdl_once_enter()
+  bool built;  // false when the table could not be allocated, lookups then scan the symbol table
+  xdl_addr_sym_t *syms;
+  size_t cnt;
+} xdl_addr_index_t;
+
 typedef struct xdl {
   char *pathname;
   uintptr_t load_bias;
   const ElfW(Phdr) *dlpi_phdr;
   ElfW(Half) dlpi_phnum;
 
-  struct xdl *next;     // to next xdl obj for cache in xdl_addr()
+  struct xdl *next;     // to next xdl obj in the xdl_addr() cache, which owns it
   void *linker_handle;  // hold handle returned by xdl_linker_load()
 
+  // serializes the lazy loads below, lookups only take it until the tables they need are loaded
+  pthread_mutex_t init_lock;
+
   //
   // (1) for searching symbols from .dynsym
   //
 
-  bool dynsym_try_load;
+  bool dynsym_try_load;  // set once loaded or given up on, see xdl_once_enter()
   ElfW(Sym) *dynsym;   // .dynsym
   const char *dynstr;  // .dynstr
 
@@ -101,17 +126,79 @@ typedef struct xdl {
   // (2) for searching symbols from .symtab
   //
 
-  bool symtab_try_load;
+  bool symtab_try_load;  // set once loaded and indexed or given up on, see xdl_once_enter()
   uintptr_t base;
 
   ElfW(Sym) *symtab;  // .symtab
   size_t symtab_cnt;
   char *strtab;  // .strtab
   size_t strtab_sz;
+
+  // read-only mapping of the ELF file or of its symtab cache file that symtab and strtab point
+  // into; when NULL they are heap copies (from .gnu_debugdata, or when the file could not be mapped)
+  void *file_map;
+  size_t file_map_sz;
+
+  // open addressing hash index over the exported .symtab names, built once .symtab is loaded
+  xdl_symtab_slot_t *symtab_slots;
+  uint32_t symtab_slots_mask;
+  size_t symtab_indexed_cnt;
+  uint64_t symtab_index_ns;
+
+  //
+  // (3) for searching symbols by address in xdl_addr()
+  //
+
+  xdl_addr_index_t dynsym_addr_index;
+  xdl_addr_index_t symtab_addr_index;
 } xdl_t;
 
+// one PT_LOAD segment of a cached handle
+typedef struct {
+  uintptr_t start;
+  uintptr_t end;
+  xdl_t *handle;
+} xdl_addr_range_t;
+
+// what the cache argument of xdl_addr() points to
+typedef struct {
+  xdl_addr_range_t *ranges;  // sorted by start, segments never overlap
+  size_t ranges_cnt;
+  size_t ranges_cap;
+  xdl_t *handles;  // every handle opened for this cache
+  bool degraded;   // a handle is missing from ranges because it could not grow
+} xdl_addr_cache_t;
+
+// header of a symtab cache file, followed by the symbols and then the strings
+#define XDL_SYMTAB_CACHE_MAGIC 0x4d595358  // "XSYM"
+typedef struct {
+  uint32_t magic;
+  uint32_t sym_sz;  // sizeof(ElfW(Sym)), 32 and 64-bit processes may share the directory
+  uint64_t symtab_cnt;
+  uint64_t strtab_sz;
+} xdl_symtab_cache_hdr_t;
+
+typedef struct {
+  uint32_t hash;
+  uint32_t bucket;  // in .gnu.hash
+  size_t idx;       // in the names given to xdl_sym_batch()
+} xdl_sym_batch_item_t;
+
 #pragma clang diagnostic pop
 
+// where .symtab/.strtab extracted from .gnu_debugdata are kept, NULL to not keep them
+static char *xdl_symtab_cache_dir = NULL;
+
+// bionic leaves the d_ptr entries of the dynamic section relative to the load bias; a build for
+// another linker defines its own XDL_DYNAMIC_PTR
+#ifndef XDL_DYNAMIC_PTR
+#define XDL_DYNAMIC_PTR(load_bias, d_ptr) ((uintptr_t)(load_bias) + (uintptr_t)(d_ptr))
+#endif
+
+static uintptr_t xdl_dynamic_ptr(xdl_t *self, ElfW(Addr) d_ptr) {
+  return XDL_DYNAMIC_PTR(self->load_bias, d_ptr);
+}
+
 // load from memory
 static int xdl_dynsym_load(xdl_t *self) {
   // find the dynamic segment
@@ -129,23 +216,23 @@ static int xdl_dynsym_load(xdl_t *self) {
   for (ElfW(Dyn) *entry = dynamic; entry && entry->d_tag != DT_NULL; entry++) {
     switch (entry->d_tag) {
       case DT_SYMTAB:  //.dynsym
-        self->dynsym = (ElfW(Sym) *)(self->load_bias + entry->d_un.d_ptr);
+        self->dynsym = (ElfW(Sym) *)xdl_dynamic_ptr(self, entry->d_un.d_ptr);
         break;
       case DT_STRTAB:  //.dynstr
-        self->dynstr = (const char *)(self->load_bias + entry->d_un.d_ptr);
+        self->dynstr = (const char *)xdl_dynamic_ptr(self, entry->d_un.d_ptr);
         break;
       case DT_HASH:  //.hash
-        self->sysv_hash.buckets_cnt = ((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[0];
-        self->sysv_hash.chains_cnt = ((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[1];
-        self->sysv_hash.buckets = &(((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[2]);
+        self->sysv_hash.buckets_cnt = ((const uint32_t *)xdl_dynamic_ptr(self, entry->d_un.d_ptr))[0];
+        self->sysv_hash.chains_cnt = ((const uint32_t *)xdl_dynamic_ptr(self, entry->d_un.d_ptr))[1];
+        self->sysv_hash.buckets = &(((const uint32_t *)xdl_dynamic_ptr(self, entry->d_un.d_ptr))[2]);
         self->sysv_hash.chains = &(self->sysv_hash.buckets[self->sysv_hash.buckets_cnt]);
         break;
       case DT_GNU_HASH:  //.gnu.hash
-        self->gnu_hash.buckets_cnt = ((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[0];
-        self->gnu_hash.symoffset = ((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[1];
-        self->gnu_hash.bloom_cnt = ((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[2];
-        self->gnu_hash.bloom_shift = ((const uint32_t *)(self->load_bias + entry->d_un.d_ptr))[3];
-        self->gnu_hash.bloom = (const ElfW(Addr) *)(self->load_bias + entry->d_un.d_ptr + 16);
+        self->gnu_hash.buckets_cnt = ((const uint32_t *)xdl_dynamic_ptr(self, entry->d_un.d_ptr))[0];
+        self->gnu_hash.symoffset = ((const uint32_t *)xdl_dynamic_ptr(self, entry->d_un.d_ptr))[1];
+        self->gnu_hash.bloom_cnt = ((const uint32_t *)xdl_dynamic_ptr(self, entry->d_un.d_ptr))[2];
+        self->gnu_hash.bloom_shift = ((const uint32_t *)xdl_dynamic_ptr(self, entry->d_un.d_ptr))[3];
+        self->gnu_hash.bloom = (const ElfW(Addr) *)(xdl_dynamic_ptr(self, entry->d_un.d_ptr) + 16);
         self->gnu_hash.buckets = (const uint32_t *)(&(self->gnu_hash.bloom[self->gnu_hash.bloom_cnt]));
         self->gnu_hash.chains = (const uint32_t *)(&(self->gnu_hash.buckets[self->gnu_hash.buckets_cnt]));
         break;
@@ -166,6 +253,31 @@ static int xdl_dynsym_load(xdl_t *self) {
   return 0;
 }
 
+// A handle may be shared by threads. Each lazily loaded table has a flag that is read with
+// acquire order and set with release order after the table is final, so once it is set lookups
+// read the table without locking. Returns true when the caller has to load the table and then
+// call xdl_once_leave(), with init_lock held.
+static bool xdl_once_enter(xdl_t *self, bool *done) {
+  if (__atomic_load_n(done, __ATOMIC_ACQUIRE)) return false;
+
+  pthread_mutex_lock(&self->init_lock);
+  if (!*done) return true;
+  pthread_mutex_unlock(&self->init_lock);
+  return false;
+}
+
+static void xdl_once_leave(xdl_t *self, bool *done) {
+  __atomic_store_n(done, true, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&self->init_lock);
+}
+
+static void xdl_dynsym_load_once(xdl_t *self) {
+  if (xdl_once_enter(self, &self->dynsym_try_load)) {
+    xdl_dynsym_load(self);
+    xdl_once_leave(self, &self->dynsym_try_load);
+  }
+}
+
 static void *xdl_read_file_to_heap(int file_fd, size_t file_sz, size_t data_offset, size_t data_len) {
   if (0 == data_len) return NULL;
   if (data_offset >= file_sz) return NULL;
@@ -221,14 +333,18 @@ static void *xdl_get_memory_by_section(void *mem, size_t mem_sz, ElfW(Shdr) *shd
 }
 
 // load from disk and memory
-static int xdl_symtab_load_from_debugdata(xdl_t *self, int file_fd, size_t file_sz,
+static int xdl_symtab_load_from_debugdata(xdl_t *self, int file_fd, size_t file_sz, void *file_map,
                                           ElfW(Shdr) *shdr_debugdata) {
   void *debugdata = NULL;
   ElfW(Shdr) *shdrs = NULL;
   int r = -1;
 
-  // get zipped .gnu_debugdata
-  uint8_t *debugdata_zip = (uint8_t *)xdl_read_file_to_heap_by_section(file_fd, file_sz, shdr_debugdata);
+  // get zipped .gnu_debugdata, straight from the file mapping when there is one
+  uint8_t *debugdata_zip;
+  if (NULL != file_map)
+    debugdata_zip = (uint8_t *)xdl_get_memory_by_section(file_map, file_sz, shdr_debugdata);
+  else
+    debugdata_zip = (uint8_t *)xdl_read_file_to_heap_by_section(file_fd, file_sz, shdr_debugdata);
   if (NULL == debugdata_zip) return -1;
 
   // get unzipped .gnu_debugdata
@@ -280,17 +396,123 @@ static int xdl_symtab_load_from_debugdata(xdl_t *self, int file_fd, size_t file_
   }
 
 end:
-  free(debugdata_zip);
+  if (NULL == file_map) free(debugdata_zip);
   if (NULL != debugdata) free(debugdata);
   if (NULL != shdrs) free(shdrs);
   return r;
 }
 
+// NT_GNU_BUILD_ID of the loaded image, returns its length or 0
+static size_t xdl_get_build_id(xdl_t *self, const uint8_t **build_id) {
+  for (size_t i = 0; i < self->dlpi_phnum; i++) {
+    const ElfW(Phdr) *phdr = &(self->dlpi_phdr[i]);
+    if (PT_NOTE != phdr->p_type) continue;
+
+    const uint8_t *note = (const uint8_t *)(self->load_bias + phdr->p_vaddr);
+    const uint8_t *note_end = note + phdr->p_memsz;
+    while (note + sizeof(ElfW(Nhdr)) <= note_end) {
+      const ElfW(Nhdr) *nhdr = (const ElfW(Nhdr) *)note;
+      const uint8_t *name = note + sizeof(ElfW(Nhdr));
+      const uint8_t *desc = name + ((nhdr->n_namesz + 3) & ~3u);
+      if (desc + nhdr->n_descsz > note_end) break;
+      if (NT_GNU_BUILD_ID == nhdr->n_type && 4 == nhdr->n_namesz && 0 == memcmp(name, "GNU", 4) &&
+          nhdr->n_descsz > 0) {
+        *build_id = desc;
+        return nhdr->n_descsz;
+      }
+      note = desc + ((nhdr->n_descsz + 3) & ~3u);
+    }
+  }
+  return 0;
+}
+
+// "<cache dir>/<hex build-id>.symtab"
+static bool xdl_symtab_cache_pathname(xdl_t *self, char *buf, size_t buf_len) {
+  if (NULL == xdl_symtab_cache_dir) return false;
+
+  const uint8_t *build_id;
+  size_t build_id_len = xdl_get_build_id(self, &build_id);
+  if (0 == build_id_len) return false;
+
+  int len = snprintf(buf, buf_len, "%s/", xdl_symtab_cache_dir);
+  if (len < 0 || (size_t)len + build_id_len * 2 + sizeof(".symtab") > buf_len) return false;
+  for (size_t i = 0; i < build_id_len; i++) len += snprintf(buf + len, buf_len - (size_t)len, "%02x", build_id[i]);
+  memcpy(buf + len, ".symtab", sizeof(".symtab"));
+  return true;
+}
+
+static int xdl_symtab_load_from_cache(xdl_t *self, const char *pathname) {
+  int fd = open(pathname, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  struct stat st;
+  void *map = MAP_FAILED;
+  if (0 == fstat(fd, &st) && (size_t)st.st_size > sizeof(xdl_symtab_cache_hdr_t))
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (MAP_FAILED == map) return -1;
+
+  // a truncated or foreign file is ignored, the next extraction replaces it
+  size_t file_sz = (size_t)st.st_size;
+  size_t data_sz = file_sz - sizeof(xdl_symtab_cache_hdr_t);
+  xdl_symtab_cache_hdr_t *hdr = (xdl_symtab_cache_hdr_t *)map;
+  if (XDL_SYMTAB_CACHE_MAGIC != hdr->magic || sizeof(ElfW(Sym)) != hdr->sym_sz || 0 == hdr->strtab_sz ||
+      hdr->symtab_cnt > data_sz / sizeof(ElfW(Sym)) ||
+      hdr->symtab_cnt * sizeof(ElfW(Sym)) + hdr->strtab_sz != data_sz) {
+    munmap(map, file_sz);
+    return -1;
+  }
+
+  self->file_map = map;
+  self->file_map_sz = file_sz;
+  self->symtab = (ElfW(Sym) *)(hdr + 1);
+  self->symtab_cnt = (size_t)hdr->symtab_cnt;
+  self->strtab = (char *)(self->symtab + self->symtab_cnt);
+  self->strtab_sz = (size_t)hdr->strtab_sz;
+  return 0;
+}
+
+static bool xdl_write_all(int fd, const void *buf, size_t len) {
+  while (len > 0) {
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wgnu-statement-expression"
+    ssize_t n = XDL_UTIL_TEMP_FAILURE_RETRY(write(fd, buf, len));
+#pragma clang diagnostic pop
+    if (n <= 0) return false;
+    buf = (const uint8_t *)buf + n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+static void xdl_symtab_save_to_cache(xdl_t *self, const char *pathname) {
+  mkdir(xdl_symtab_cache_dir, 0700);
+
+  // written under a private name and renamed, readers never see a partial file; a name that does
+  // not fit is not cached, a truncated one could be another process's temp file
+  char tmp_pathname[1024];
+  int len = snprintf(tmp_pathname, sizeof(tmp_pathname), "%s.%d.tmp", pathname, getpid());
+  if (len < 0 || (size_t)len >= sizeof(tmp_pathname)) return;
+  int fd = open(tmp_pathname, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) return;
+
+  xdl_symtab_cache_hdr_t hdr = {.magic = XDL_SYMTAB_CACHE_MAGIC,
+                                .sym_sz = sizeof(ElfW(Sym)),
+                                .symtab_cnt = self->symtab_cnt,
+                                .strtab_sz = self->strtab_sz};
+  bool ok = xdl_write_all(fd, &hdr, sizeof(hdr)) &&
+            xdl_write_all(fd, self->symtab, self->symtab_cnt * sizeof(ElfW(Sym))) &&
+            xdl_write_all(fd, self->strtab, self->strtab_sz);
+  if (0 != close(fd)) ok = false;
+  if (!ok || 0 != rename(tmp_pathname, pathname)) unlink(tmp_pathname);
+}
+
 // load from disk and memory
 static int xdl_symtab_load(xdl_t *self) {
   if ('[' == self->pathname[0]) return -1;
 
   int r = -1;
+  void *file_map = NULL;
+  bool mapped = false;
   ElfW(Shdr) *shdrs = NULL;
   char *shstrtab = NULL;
 
@@ -326,18 +548,34 @@ static int xdl_symtab_load(xdl_t *self) {
   if (0 != fstat(file_fd, &st)) goto end;
   size_t file_sz = (size_t)st.st_size;
 
+  // Map the whole file once: section headers and names are read from it, and .symtab/.strtab are
+  // used in place, so they stay clean page cache instead of private heap. Without a mapping, read
+  // each section into the heap.
+  if (file_sz > 0) {
+    file_map = mmap(NULL, file_sz, PROT_READ, MAP_PRIVATE, file_fd, 0);
+    if (MAP_FAILED == file_map) file_map = NULL;
+  }
+  mapped = NULL != file_map;
+
   // get ELF header
   ElfW(Ehdr) *ehdr = (ElfW(Ehdr) *)self->base;
   if (0 == ehdr->e_shnum || ehdr->e_shentsize != sizeof(ElfW(Shdr))) goto end;
 
   // get section headers
-  shdrs = (ElfW(Shdr) *)xdl_read_file_to_heap(file_fd, file_sz, (size_t)ehdr->e_shoff,
-                                              ehdr->e_shentsize * ehdr->e_shnum);
+  if (NULL != file_map)
+    shdrs = (ElfW(Shdr) *)xdl_get_memory(file_map, file_sz, (size_t)ehdr->e_shoff,
+                                         ehdr->e_shentsize * ehdr->e_shnum);
+  else
+    shdrs = (ElfW(Shdr) *)xdl_read_file_to_heap(file_fd, file_sz, (size_t)ehdr->e_shoff,
+                                                ehdr->e_shentsize * ehdr->e_shnum);
   if (NULL == shdrs) goto end;
 
   // get .shstrtab
   if (SHN_UNDEF == ehdr->e_shstrndx || ehdr->e_shstrndx >= ehdr->e_shnum) goto end;
-  shstrtab = (char *)xdl_read_file_to_heap_by_section(file_fd, file_sz, shdrs + ehdr->e_shstrndx);
+  if (NULL != file_map)
+    shstrtab = (char *)xdl_get_memory_by_section(file_map, file_sz, shdrs + ehdr->e_shstrndx);
+  else
+    shstrtab = (char *)xdl_read_file_to_heap_by_section(file_fd, file_sz, shdrs + ehdr->e_shstrndx);
   if (NULL == shstrtab) goto end;
 
   // find .symtab & .strtab
@@ -351,23 +589,47 @@ static int xdl_symtab_load(xdl_t *self) {
       if (SHT_STRTAB != shdr_strtab->sh_type) continue;
 
       // get .symtab & .strtab
-      ElfW(Sym) *symtab = (ElfW(Sym) *)xdl_read_file_to_heap_by_section(file_fd, file_sz, shdr);
-      if (NULL == symtab) continue;
-      char *strtab = (char *)xdl_read_file_to_heap_by_section(file_fd, file_sz, shdr_strtab);
-      if (NULL == strtab) {
-        free(symtab);
-        continue;
-      }
+      if (NULL != file_map && 0 == shdr->sh_offset % sizeof(ElfW(Addr))) {
+        ElfW(Sym) *symtab = (ElfW(Sym) *)xdl_get_memory_by_section(file_map, file_sz, shdr);
+        char *strtab = (char *)xdl_get_memory_by_section(file_map, file_sz, shdr_strtab);
+        if (NULL == symtab || NULL == strtab) continue;
+
+        // OK, keep the mapping
+        self->file_map = file_map;
+        self->file_map_sz = file_sz;
+        file_map = NULL;
+        self->symtab = symtab;
+        self->strtab = strtab;
+      } else {
+        ElfW(Sym) *symtab = (ElfW(Sym) *)xdl_read_file_to_heap_by_section(file_fd, file_sz, shdr);
+        if (NULL == symtab) continue;
+        char *strtab = (char *)xdl_read_file_to_heap_by_section(file_fd, file_sz, shdr_strtab);
+        if (NULL == strtab) {
+          free(symtab);
+          continue;
+        }
 
-      // OK
-      self->symtab = symtab;
+        // OK
+        self->symtab = symtab;
+        self->strtab = strtab;
+      }
       self->symtab_cnt = shdr->sh_size / shdr->sh_entsize;
-      self->strtab = strtab;
       self->strtab_sz = shdr_strtab->sh_size;
       r = 0;
       break;
     } else if (SHT_PROGBITS == shdr->sh_type && 0 == strcmp(".gnu_debugdata", shdr_name)) {
-      if (0 == xdl_symtab_load_from_debugdata(self, file_fd, file_sz, shdr)) {
+      // decompressing is slow, reuse what an earlier process extracted from the same build
+      char cache_pathname[1024];
+      bool cacheable = xdl_symtab_cache_pathname(self, cache_pathname, sizeof(cache_pathname));
+      if (cacheable && 0 == xdl_symtab_load_from_cache(self, cache_pathname)) {
+        // OK
+        r = 0;
+        break;
+      }
+
+      // the inner ELF only exists after decompression, so it is copied to the heap
+      if (0 == xdl_symtab_load_from_debugdata(self, file_fd, file_sz, file_map, shdr)) {
+        if (cacheable) xdl_symtab_save_to_cache(self, cache_pathname);
         // OK
         r = 0;
         break;
@@ -377,8 +639,13 @@ static int xdl_symtab_load(xdl_t *self) {
 
 end:
   close(file_fd);
-  if (NULL != shdrs) free(shdrs);
-  if (NULL != shstrtab) free(shstrtab);
+  if (mapped) {
+    // shdrs and shstrtab point into the mapping, which is unmapped unless .symtab kept it
+    if (NULL != file_map) munmap(file_map, file_sz);
+  } else {
+    if (NULL != shdrs) free(shdrs);
+    if (NULL != shstrtab) free(shstrtab);
+  }
   return r;
 }
 
@@ -418,8 +685,38 @@ static xdl_t *xdl_find_from_auxv(unsigned long type, const char *pathname) {
   self->load_bias = load_bias;
   self->dlpi_phdr = dlpi_phdr;
   self->dlpi_phnum = dlpi_phnum;
-  self->dynsym_try_load = false;
-  self->symtab_try_load = false;
+  pthread_mutex_init(&self->init_lock, NULL);
+  return self;
+}
+
+// same rules as xdl_open(): a path, a basename or a "[name]" like the vDSO
+static bool xdl_find_is_match(const char *dlpi_name, const char *filename) {
+  if ('[' == filename[0]) return 0 == strcmp(dlpi_name, filename);
+
+  if ('/' == filename[0]) {
+    if ('/' == dlpi_name[0]) return 0 == strcmp(dlpi_name, filename);
+    return xdl_util_ends_with(filename, dlpi_name);
+  } else if (NULL == strchr(filename, '/')) {
+    // a whole basename, not any suffix of one
+    const char *basename = strrchr(dlpi_name, '/');
+    return 0 == strcmp(NULL == basename ? dlpi_name : basename + 1, filename);
+  } else {
+    if ('/' == dlpi_name[0]) return xdl_util_ends_with(dlpi_name, filename);
+    return 0 == strcmp(dlpi_name, filename);
+  }
+}
+
+static xdl_t *xdl_create_from_info(struct dl_phdr_info *info) {
+  xdl_t *self;
+  if (NULL == (self = calloc(1, sizeof(xdl_t)))) return NULL;
+  if (NULL == (self->pathname = strdup(info->dlpi_name))) {
+    free(self);
+    return NULL;
+  }
+  self->load_bias = info->dlpi_addr;
+  self->dlpi_phdr = info->dlpi_phdr;
+  self->dlpi_phnum = info->dlpi_phnum;
+  pthread_mutex_init(&self->init_lock, NULL);
   return self;
 }
 
@@ -434,44 +731,20 @@ static int xdl_find_iterate_cb(struct dl_phdr_info *info, size_t size, void *arg
   if (0 == info->dlpi_addr || NULL == info->dlpi_name) return 0;
 
   // check pathname
-  if ('[' == filename[0]) {
-    if (0 != strcmp(info->dlpi_name, filename)) return 0;
-  } else if ('/' == filename[0]) {
-    if ('/' == info->dlpi_name[0]) {
-      if (0 != strcmp(info->dlpi_name, filename)) return 0;
-    } else {
-      if (!xdl_util_ends_with(filename, info->dlpi_name)) return 0;
-    }
-  } else {
-    if ('/' == info->dlpi_name[0]) {
-      if (!xdl_util_ends_with(info->dlpi_name, filename)) return 0;
-    } else {
-      if (0 != strcmp(info->dlpi_name, filename)) return 0;
-    }
-  }
+  if (!xdl_find_is_match(info->dlpi_name, filename)) return 0;
 
-  // found the target ELF
-  if (NULL == ((*self) = calloc(1, sizeof(xdl_t)))) return 1;  // return failed
-  if (NULL == ((*self)->pathname = strdup(info->dlpi_name))) {
-    free(*self);
-    *self = NULL;
-    return 1;  // return failed
-  }
-  (*self)->load_bias = info->dlpi_addr;
-  (*self)->dlpi_phdr = info->dlpi_phdr;
-  (*self)->dlpi_phnum = info->dlpi_phnum;
-  (*self)->dynsym_try_load = false;
-  (*self)->symtab_try_load = false;
-  return 1;  // return OK
+  // found the target ELF, NULL when it could not be created
+  *self = xdl_create_from_info(info);
+  return 1;
 }
 
-static xdl_t *xdl_find(const char *filename) {
+// linker, vDSO and app_process are found without iterating
+static xdl_t *xdl_find_by_auxv(const char *filename) {
   // from auxv (linker, vDSO)
-  xdl_t *self = NULL;
   if (xdl_util_ends_with(filename, XDL_UTIL_LINKER_BASENAME))
-    self = xdl_find_from_auxv(AT_BASE, XDL_UTIL_LINKER_PATHNAME);
-  else if (xdl_util_ends_with(filename, XDL_UTIL_VDSO_BASENAME))
-    self = xdl_find_from_auxv(AT_SYSINFO_EHDR, XDL_UTIL_VDSO_BASENAME);
+    return xdl_find_from_auxv(AT_BASE, XDL_UTIL_LINKER_PATHNAME);
+  if (xdl_util_ends_with(filename, XDL_UTIL_VDSO_BASENAME))
+    return xdl_find_from_auxv(AT_SYSINFO_EHDR, XDL_UTIL_VDSO_BASENAME);
 
   // from auxv (app_process)
   const char *basename, *pathname;
@@ -485,13 +758,19 @@ static xdl_t *xdl_find(const char *filename) {
     basename = XDL_UTIL_APP_PROCESS_BASENAME;
     pathname = XDL_UTIL_APP_PROCESS_PATHNAME;
   }
-  if (xdl_util_ends_with(filename, basename)) self = xdl_find_from_auxv(AT_PHDR, pathname);
+  if (xdl_util_ends_with(filename, basename)) return xdl_find_from_auxv(AT_PHDR, pathname);
+
+  return NULL;
+}
 
+static xdl_t *xdl_find(const char *filename) {
+  xdl_t *self = xdl_find_by_auxv(filename);
   if (NULL != self) return self;
 
-  // from dl_iterate_phdr
+  // from the snapshot of loaded ELFs, or from dl_iterate_phdr when it cannot be kept current
   uintptr_t pkg[2] = {(uintptr_t)&self, (uintptr_t)filename};
-  xdl_iterate_phdr(xdl_find_iterate_cb, pkg, XDL_DEFAULT);
+  if (xdl_iterate_find_by_name(filename, xdl_find_iterate_cb, pkg) < 0)
+    xdl_iterate_phdr(xdl_find_iterate_cb, pkg, XDL_DEFAULT);
   return self;
 }
 
@@ -540,13 +819,82 @@ void *xdl_open(const char *filename, int flags) {
     return xdl_find(filename);
 }
 
+// xdl_find() for every non-NULL filenames[i] whose handles[i] is still NULL. Each name goes through
+// the same snapshot lookup as xdl_open(), so a name opens here exactly when it opens there
+static void xdl_find_many(const char *const *filenames, size_t cnt, xdl_t **handles) {
+  for (size_t i = 0; i < cnt; i++)
+    if (NULL != filenames[i] && NULL == handles[i]) handles[i] = xdl_find(filenames[i]);
+}
+
+size_t xdl_open_many(const char *const *filenames, size_t cnt, int flags, void **handles) {
+  if (NULL == filenames || NULL == handles) return 0;
+  memset(handles, 0, cnt * sizeof(void *));
+
+  // names searched in this pass, and what the linker loaded for them
+  const char **wanted = calloc(cnt, sizeof(const char *));
+  void **linker_handles = calloc(cnt, sizeof(void *));
+  if (NULL == wanted || NULL == linker_handles) {
+    if (NULL != wanted) free(wanted);
+    if (NULL != linker_handles) free(linker_handles);
+    // one xdl_open() per name
+    for (size_t i = 0; i < cnt; i++) handles[i] = xdl_open(filenames[i], flags);
+  } else {
+    // always force dlopen(), only the loaded ones are searched
+    for (size_t i = 0; i < cnt; i++) {
+      if (NULL == filenames[i]) continue;
+      if (flags & XDL_ALWAYS_FORCE_LOAD) {
+        if (NULL == (linker_handles[i] = xdl_linker_load(filenames[i]))) continue;
+      }
+      wanted[i] = filenames[i];
+    }
+    xdl_find_many(wanted, cnt, (xdl_t **)handles);
+
+    // try force dlopen() for the missing ones, then find those again
+    if (!(flags & XDL_ALWAYS_FORCE_LOAD) && (flags & XDL_TRY_FORCE_LOAD)) {
+      bool loaded = false;
+      for (size_t i = 0; i < cnt; i++) {
+        wanted[i] = NULL;
+        if (NULL == filenames[i] || NULL != handles[i]) continue;
+        if (NULL == (linker_handles[i] = xdl_linker_load(filenames[i]))) continue;
+        wanted[i] = filenames[i];
+        loaded = true;
+      }
+      if (loaded) xdl_find_many(wanted, cnt, (xdl_t **)handles);
+    }
+
+    // the handles keep what the linker loaded for them
+    for (size_t i = 0; i < cnt; i++) {
+      if (NULL == linker_handles[i]) continue;
+      if (NULL == handles[i])
+        dlclose(linker_handles[i]);
+      else
+        ((xdl_t *)handles[i])->linker_handle = linker_handles[i];
+    }
+    free(wanted);
+    free(linker_handles);
+  }
+
+  size_t opened = 0;
+  for (size_t i = 0; i < cnt; i++)
+    if (NULL != handles[i]) opened++;
+  return opened;
+}
+
 void *xdl_close(void *handle) {
   if (NULL == handle) return NULL;
 
   xdl_t *self = (xdl_t *)handle;
   if (NULL != self->pathname) free(self->pathname);
-  if (NULL != self->symtab) free(self->symtab);
-  if (NULL != self->strtab) free(self->strtab);
+  if (NULL != self->file_map) {
+    munmap(self->file_map, self->file_map_sz);
+  } else {
+    if (NULL != self->symtab) free(self->symtab);
+    if (NULL != self->strtab) free(self->strtab);
+  }
+  if (NULL != self->symtab_slots) free(self->symtab_slots);
+  if (NULL != self->dynsym_addr_index.syms) free(self->dynsym_addr_index.syms);
+  if (NULL != self->symtab_addr_index.syms) free(self->symtab_addr_index.syms);
+  pthread_mutex_destroy(&self->init_lock);
 
   void *linker_handle = self->linker_handle;
   free(self);
@@ -629,10 +977,7 @@ void *xdl_sym(void *handle, const char *symbol, size_t *symbol_size) {
   xdl_t *self = (xdl_t *)handle;
 
   // load .dynsym only once
-  if (!self->dynsym_try_load) {
-    self->dynsym_try_load = true;
-    if (0 != xdl_dynsym_load(self)) return NULL;
-  }
+  xdl_dynsym_load_once(self);
 
   // find symbol
   if (NULL == self->dynsym) return NULL;
@@ -651,33 +996,255 @@ void *xdl_sym(void *handle, const char *symbol, size_t *symbol_size) {
   return (void *)(self->load_bias + sym->st_value);
 }
 
-void *xdl_dsym(void *handle, const char *symbol, size_t *symbol_size) {
-  if (NULL == handle || NULL == symbol) return NULL;
-  if (NULL != symbol_size) *symbol_size = 0;
+// stable LSD radix sort on the bucket, one pass per byte of the largest bucket number; returns
+// whichever of the two buffers holds the result
+static xdl_sym_batch_item_t *xdl_sym_batch_sort(xdl_sym_batch_item_t *items, xdl_sym_batch_item_t *tmp,
+                                                size_t cnt, uint32_t buckets_cnt) {
+  for (uint32_t shift = 0; shift < 32 && (buckets_cnt - 1) >> shift > 0; shift += 8) {
+    uint32_t offsets[257] = {0};
+    for (size_t i = 0; i < cnt; i++) offsets[((items[i].bucket >> shift) & 0xFF) + 1]++;
+    for (size_t i = 1; i < 257; i++) offsets[i] += offsets[i - 1];
+    for (size_t i = 0; i < cnt; i++) tmp[offsets[(items[i].bucket >> shift) & 0xFF]++] = items[i];
+
+    xdl_sym_batch_item_t *sorted = tmp;
+    tmp = items;
+    items = sorted;
+  }
+  return items;
+}
+
+// resolves every name through .gnu.hash in bucket order, so .gnu.hash and .dynsym are read forward once
+static bool xdl_sym_batch_use_gnu_hash(xdl_t *self, const char *const *names, size_t cnt, void **addrs,
+                                       size_t *sizes) {
+  if (cnt > UINT32_MAX) return false;
+  xdl_sym_batch_item_t *buf = malloc(cnt * 2 * sizeof(xdl_sym_batch_item_t));
+  if (NULL == buf) return false;
+  xdl_sym_batch_item_t *items = buf;
+
+  // hash every name up front, the bloom filter drops most missing ones here
+  static uint32_t elfclass_bits = sizeof(ElfW(Addr)) * 8;
+  size_t items_cnt = 0;
+  for (size_t i = 0; i < cnt; i++) {
+    if (NULL == names[i]) continue;
+    uint32_t hash = xdl_gnu_hash((const uint8_t *)names[i]);
+    size_t word = self->gnu_hash.bloom[(hash / elfclass_bits) % self->gnu_hash.bloom_cnt];
+    size_t mask = 0 | (size_t)1 << (hash % elfclass_bits) |
+                  (size_t)1 << ((hash >> self->gnu_hash.bloom_shift) % elfclass_bits);
+    if ((word & mask) != mask) continue;
+
+    items[items_cnt].hash = hash;
+    items[items_cnt].bucket = hash % self->gnu_hash.buckets_cnt;
+    items[items_cnt].idx = i;
+    items_cnt++;
+  }
+  items = xdl_sym_batch_sort(items, items + cnt, items_cnt, self->gnu_hash.buckets_cnt);
+
+  // walk each chain once for all names in its bucket
+  for (size_t group = 0, group_end; group < items_cnt; group = group_end) {
+    for (group_end = group + 1; group_end < items_cnt && items[group_end].bucket == items[group].bucket;)
+      group_end++;
+
+    // ignore STN_UNDEF
+    uint32_t i = self->gnu_hash.buckets[items[group].bucket];
+    if (i < self->gnu_hash.symoffset) continue;
+
+    size_t pending = group_end - group;
+    while (pending > 0) {
+      ElfW(Sym) *sym = self->dynsym + i;
+      uint32_t sym_hash = self->gnu_hash.chains[i - self->gnu_hash.symoffset];
+
+      for (size_t j = group; j < group_end; j++) {
+        xdl_sym_batch_item_t *item = items + j;
+        if (NULL != addrs[item->idx] || (item->hash | (uint32_t)1) != (sym_hash | (uint32_t)1)) continue;
+        if (!XDL_DYNSYM_IS_EXPORT_SYM(sym->st_shndx)) continue;
+        if (0 != strcmp(self->dynstr + sym->st_name, names[item->idx])) continue;
+
+        addrs[item->idx] = (void *)(self->load_bias + sym->st_value);
+        if (NULL != sizes) sizes[item->idx] = sym->st_size;
+        pending--;
+      }
+
+      // chain ends with an element with the lowest bit set to 1
+      if (sym_hash & (uint32_t)1) break;
+
+      i++;
+    }
+  }
+
+  free(buf);
+  return true;
+}
+
+size_t xdl_sym_batch(void *handle, const char *const *names, size_t cnt, void **addrs, size_t *sizes,
+                     uint64_t *missing) {
+  if (NULL == handle || NULL == names || NULL == addrs) return 0;
+  memset(addrs, 0, cnt * sizeof(void *));
+  if (NULL != sizes) memset(sizes, 0, cnt * sizeof(size_t));
+  if (NULL != missing) memset(missing, 0, (cnt + 63) / 64 * sizeof(uint64_t));
 
   xdl_t *self = (xdl_t *)handle;
 
-  // load .symtab only once
-  if (!self->symtab_try_load) {
-    self->symtab_try_load = true;
-    if (0 != xdl_symtab_load(self)) return NULL;
+  // load .dynsym only once
+  xdl_dynsym_load_once(self);
+
+  // find symbols
+  if (NULL != self->dynsym) {
+    bool done = false;
+    if (self->gnu_hash.buckets_cnt > 0) {
+      // use GNU hash, one pass in bucket order
+      done = xdl_sym_batch_use_gnu_hash(self, names, cnt, addrs, sizes);
+    }
+    for (size_t i = 0; i < cnt; i++) {
+      if (NULL != addrs[i] || NULL == names[i]) continue;
+      ElfW(Sym) *sym = NULL;
+      if (!done && self->gnu_hash.buckets_cnt > 0) {
+        // no memory for the batch, one name at a time
+        sym = xdl_dynsym_find_symbol_use_gnu_hash(self, names[i]);
+      }
+      if (NULL == sym && self->sysv_hash.buckets_cnt > 0) {
+        // use SYSV hash for what .gnu.hash does not have, like xdl_sym()
+        sym = xdl_dynsym_find_symbol_use_sysv_hash(self, names[i]);
+      }
+      if (NULL == sym || !XDL_DYNSYM_IS_EXPORT_SYM(sym->st_shndx)) continue;
+
+      addrs[i] = (void *)(self->load_bias + sym->st_value);
+      if (NULL != sizes) sizes[i] = sym->st_size;
+    }
   }
 
-  // find symbol
-  if (NULL == self->symtab) return NULL;
+  size_t found = 0;
+  for (size_t i = 0; i < cnt; i++) {
+    if (NULL != addrs[i])
+      found++;
+    else if (NULL != missing)
+      missing[i / 64] |= (uint64_t)1 << (i % 64);
+  }
+  return found;
+}
+
+static uint64_t xdl_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// same as xdl_gnu_hash(), but never reads past the end of .strtab
+static uint32_t xdl_gnu_hash_n(const uint8_t *name, size_t max_len) {
+  uint32_t h = 5381;
+
+  for (size_t i = 0; i < max_len && name[i]; i++) {
+    h += (h << 5) + name[i];
+  }
+  return h;
+}
+
+static uint32_t xdl_symtab_slot_of(xdl_t *self, uint32_t hash) {
+  // GNU hash is weak in its low bits, spread it before masking
+  return (uint32_t)(((uint64_t)hash * 0x9E3779B97F4A7C15ull) >> 32) & self->symtab_slots_mask;
+}
+
+static bool xdl_symtab_is_indexable(xdl_t *self, ElfW(Sym) *sym) {
+  return XDL_SYMTAB_IS_EXPORT_SYM(sym->st_shndx) && sym->st_name < self->strtab_sz &&
+         '\0' != self->strtab[sym->st_name];
+}
+
+static void xdl_symtab_index_build(xdl_t *self) {
+  if (NULL == self->symtab || self->symtab_cnt >= UINT32_MAX) return;
+  uint64_t begin = xdl_now_ns();
+
+  // at most half full
+  size_t cnt = 0;
+  for (size_t i = 0; i < self->symtab_cnt; i++)
+    if (xdl_symtab_is_indexable(self, self->symtab + i)) cnt++;
+  size_t slots_cnt = 16;
+  while (slots_cnt < cnt * 2) slots_cnt *= 2;
+  if (slots_cnt > (size_t)UINT32_MAX + 1) return;
+  xdl_symtab_slot_t *slots = calloc(slots_cnt, sizeof(xdl_symtab_slot_t));
+  if (NULL == slots) return;  // xdl_dsym() falls back to the linear scan
+  self->symtab_slots = slots;
+  self->symtab_slots_mask = (uint32_t)(slots_cnt - 1);
+
+  for (size_t i = 0; i < self->symtab_cnt; i++) {
+    ElfW(Sym) *sym = self->symtab + i;
+    if (!xdl_symtab_is_indexable(self, sym)) continue;
+
+    const char *name = self->strtab + sym->st_name;
+    size_t max_len = self->strtab_sz - sym->st_name;
+    uint32_t hash = xdl_gnu_hash_n((const uint8_t *)name, max_len);
+    uint32_t n = xdl_symtab_slot_of(self, hash);
+    for (; 0 != slots[n].sym; n = (n + 1) & self->symtab_slots_mask) {
+      // keep the first definition, like the linear scan did
+      if (slots[n].hash == hash &&
+          0 == strncmp(self->strtab + self->symtab[slots[n].sym - 1].st_name, name, max_len))
+        break;
+    }
+    if (0 != slots[n].sym) continue;
+    slots[n].hash = hash;
+    slots[n].sym = (uint32_t)i + 1;
+    self->symtab_indexed_cnt++;
+  }
+
+  self->symtab_index_ns = xdl_now_ns() - begin;
+}
+
+static ElfW(Sym) *xdl_symtab_find_symbol_use_index(xdl_t *self, const char *sym_name) {
+  uint32_t hash = xdl_gnu_hash((const uint8_t *)sym_name);
+
+  for (uint32_t n = xdl_symtab_slot_of(self, hash); 0 != self->symtab_slots[n].sym;
+       n = (n + 1) & self->symtab_slots_mask) {
+    if (self->symtab_slots[n].hash != hash) continue;
+    ElfW(Sym) *sym = self->symtab + self->symtab_slots[n].sym - 1;
+    if (0 == strncmp(self->strtab + sym->st_name, sym_name, self->strtab_sz - sym->st_name)) return sym;
+  }
+
+  return NULL;
+}
+
+static ElfW(Sym) *xdl_symtab_find_symbol_use_scan(xdl_t *self, const char *sym_name) {
   for (size_t i = 0; i < self->symtab_cnt; i++) {
     ElfW(Sym) *sym = self->symtab + i;
 
     if (!XDL_SYMTAB_IS_EXPORT_SYM(sym->st_shndx)) continue;
-    if (0 != strncmp(self->strtab + sym->st_name, symbol, self->strtab_sz - sym->st_name)) continue;
+    if (0 != strncmp(self->strtab + sym->st_name, sym_name, self->strtab_sz - sym->st_name)) continue;
 
-    if (NULL != symbol_size) *symbol_size = sym->st_size;
-    return (void *)(self->load_bias + sym->st_value);
+    return sym;
   }
 
   return NULL;
 }
 
+static void xdl_symtab_load_once(xdl_t *self) {
+  if (xdl_once_enter(self, &self->symtab_try_load)) {
+    if (0 == xdl_symtab_load(self)) xdl_symtab_index_build(self);
+    xdl_once_leave(self, &self->symtab_try_load);
+  }
+}
+
+void *xdl_dsym(void *handle, const char *symbol, size_t *symbol_size) {
+  if (NULL == handle || NULL == symbol) return NULL;
+  if (NULL != symbol_size) *symbol_size = 0;
+
+  xdl_t *self = (xdl_t *)handle;
+
+  // load .symtab only once
+  xdl_symtab_load_once(self);
+
+  // find symbol
+  if (NULL == self->symtab) return NULL;
+  ElfW(Sym) *sym;
+  if (NULL != self->symtab_slots) {
+    // use the hash index, O(1)
+    sym = xdl_symtab_find_symbol_use_index(self, symbol);
+  } else {
+    // the index could not be allocated, O(n)
+    sym = xdl_symtab_find_symbol_use_scan(self, symbol);
+  }
+  if (NULL == sym) return NULL;
+
+  if (NULL != symbol_size) *symbol_size = sym->st_size;
+  return (void *)(self->load_bias + sym->st_value);
+}
+
 static bool xdl_elf_is_match(uintptr_t load_bias, const ElfW(Phdr) *dlpi_phdr, ElfW(Half) dlpi_phnum,
                              uintptr_t addr) {
   if (addr < load_bias) return false;
@@ -701,19 +1268,9 @@ static int xdl_open_by_addr_iterate_cb(struct dl_phdr_info *info, size_t size, v
   uintptr_t addr = *pkg;
 
   if (xdl_elf_is_match(info->dlpi_addr, info->dlpi_phdr, info->dlpi_phnum, addr)) {
-    // found the target ELF
-    if (NULL == ((*self) = calloc(1, sizeof(xdl_t)))) return 1;  // failed
-    if (NULL == ((*self)->pathname = strdup(info->dlpi_name))) {
-      free(*self);
-      *self = NULL;
-      return 1;  // failed
-    }
-    (*self)->load_bias = info->dlpi_addr;
-    (*self)->dlpi_phdr = info->dlpi_phdr;
-    (*self)->dlpi_phnum = info->dlpi_phnum;
-    (*self)->dynsym_try_load = false;
-    (*self)->symtab_try_load = false;
-    return 1;  // OK
+    // found the target ELF, NULL when it could not be created
+    *self = xdl_create_from_info(info);
+    return 1;
   }
 
   return 0;  // mismatch
@@ -724,34 +1281,117 @@ static void *xdl_open_by_addr(void *addr) {
 
   xdl_t *self = NULL;
   uintptr_t pkg[2] = {(uintptr_t)&self, (uintptr_t)addr};
-  xdl_iterate_phdr(xdl_open_by_addr_iterate_cb, pkg, XDL_DEFAULT);
+  if (xdl_iterate_find_by_addr((uintptr_t)addr, xdl_open_by_addr_iterate_cb, pkg) < 0)
+    xdl_iterate_phdr(xdl_open_by_addr_iterate_cb, pkg, XDL_DEFAULT);
 
   return (void *)self;
 }
 
 static bool xdl_sym_is_match(ElfW(Sym) *sym, uintptr_t offset, bool is_symtab) {
   if (is_symtab) {
-    if (!XDL_SYMTAB_IS_EXPORT_SYM(sym->st_shndx)) false;
+    if (!XDL_SYMTAB_IS_EXPORT_SYM(sym->st_shndx)) return false;
   } else {
-    if (!XDL_DYNSYM_IS_EXPORT_SYM(sym->st_shndx)) false;
+    if (!XDL_DYNSYM_IS_EXPORT_SYM(sym->st_shndx)) return false;
   }
 
   return ELF_ST_TYPE(sym->st_info) != STT_TLS && offset >= sym->st_value &&
          offset < sym->st_value + sym->st_size;
 }
 
-static ElfW(Sym) *xdl_sym_by_addr(void *handle, void *addr) {
-  xdl_t *self = (xdl_t *)handle;
+static bool xdl_addr_sym_is_indexable(ElfW(Sym) *sym, bool is_symtab) {
+  if (is_symtab) {
+    if (!XDL_SYMTAB_IS_EXPORT_SYM(sym->st_shndx)) return false;
+  } else {
+    if (!XDL_DYNSYM_IS_EXPORT_SYM(sym->st_shndx)) return false;
+  }
 
-  // load .dynsym only once
-  if (!self->dynsym_try_load) {
-    self->dynsym_try_load = true;
-    if (0 != xdl_dynsym_load(self)) return NULL;
+  // a symbol without size can never contain an address
+  return ELF_ST_TYPE(sym->st_info) != STT_TLS && sym->st_size > 0;
+}
+
+static int xdl_addr_sym_cmp(const void *a, const void *b) {
+  const xdl_addr_sym_t *x = (const xdl_addr_sym_t *)a, *y = (const xdl_addr_sym_t *)b;
+  if (x->start != y->start) return x->start < y->start ? -1 : 1;
+  if (x->end != y->end) return x->end < y->end ? -1 : 1;
+  return x->sym < y->sym ? -1 : (x->sym > y->sym ? 1 : 0);
+}
+
+static void xdl_addr_index_build(xdl_addr_index_t *index, ElfW(Sym) *syms, size_t begin, size_t end,
+                                 bool is_symtab) {
+  size_t cnt = 0;
+  for (size_t i = begin; i < end; i++)
+    if (xdl_addr_sym_is_indexable(syms + i, is_symtab)) cnt++;
+  if (cnt > 0 && NULL == (index->syms = malloc(cnt * sizeof(xdl_addr_sym_t)))) return;
+
+  for (size_t i = begin; i < end; i++) {
+    ElfW(Sym) *sym = syms + i;
+    if (!xdl_addr_sym_is_indexable(sym, is_symtab)) continue;
+    xdl_addr_sym_t *entry = index->syms + index->cnt++;
+    entry->start = sym->st_value;
+    entry->end = sym->st_value + sym->st_size;
+    entry->name = sym->st_name;
+    entry->sym = (uint32_t)i;
   }
+  if (cnt > 1) qsort(index->syms, cnt, sizeof(xdl_addr_sym_t), xdl_addr_sym_cmp);
 
-  // find symbol
-  if (NULL == self->dynsym) return NULL;
-  uintptr_t offset = (uintptr_t)addr - self->load_bias;
+  // symbols may overlap, max_end tells the lookup how far back a match can start
+  ElfW(Addr) max_end = 0;
+  for (size_t i = 0; i < cnt; i++) {
+    if (index->syms[i].end > max_end) max_end = index->syms[i].end;
+    index->syms[i].max_end = max_end;
+  }
+  index->built = true;
+}
+
+// Returns the entry containing offset that comes first in the symbol table, like a scan of the
+// table would, so aliases and overlapping symbols resolve the same with and without the index.
+// With a cursor the search continues from the previous offset, so offsets in ascending order
+// cost a merge pass.
+static xdl_addr_sym_t *xdl_addr_index_find(xdl_addr_index_t *index, uintptr_t offset, size_t *cursor) {
+  xdl_addr_sym_t *syms = index->syms;
+
+  // n = number of entries starting at or below offset, everything before lo does
+  size_t lo = 0, hi = index->cnt;
+  if (NULL != cursor && *cursor <= index->cnt && (0 == *cursor || syms[*cursor - 1].start <= offset)) {
+    // gallop forward from the previous position
+    lo = hi = *cursor;
+    for (size_t step = 1; hi < index->cnt && syms[hi].start <= offset; step *= 2) {
+      lo = hi + 1;
+      hi = (index->cnt - hi > step) ? hi + step : index->cnt;
+    }
+  }
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (syms[mid].start <= offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (NULL != cursor) *cursor = lo;
+
+  xdl_addr_sym_t *found = NULL;
+  for (size_t n = lo; n > 0 && syms[n - 1].max_end > offset; n--)
+    if (offset < syms[n - 1].end && (NULL == found || syms[n - 1].sym < found->sym)) found = &syms[n - 1];
+
+  return found;
+}
+
+// number of .dynsym entries, which the dynamic section does not record
+static size_t xdl_dynsym_cnt(xdl_t *self) {
+  if (self->gnu_hash.buckets_cnt > 0) {
+    uint32_t last = 0;
+    for (size_t i = 0; i < self->gnu_hash.buckets_cnt; i++)
+      if (self->gnu_hash.buckets[i] > last) last = self->gnu_hash.buckets[i];
+    if (last < self->gnu_hash.symoffset) return self->gnu_hash.symoffset;
+
+    const uint32_t *chains_all = self->gnu_hash.chains - self->gnu_hash.symoffset;
+    while ((chains_all[last] & 1) == 0) last++;
+    return (size_t)last + 1;
+  }
+  return self->sysv_hash.chains_cnt;
+}
+
+static ElfW(Sym) *xdl_sym_by_addr_use_scan(xdl_t *self, uintptr_t offset) {
   if (self->gnu_hash.buckets_cnt > 0) {
     const uint32_t *chains_all = self->gnu_hash.chains - self->gnu_hash.symoffset;
     for (size_t i = 0; i < self->gnu_hash.buckets_cnt; i++) {
@@ -772,44 +1412,150 @@ static ElfW(Sym) *xdl_sym_by_addr(void *handle, void *addr) {
   return NULL;
 }
 
-static ElfW(Sym) *xdl_dsym_by_addr(void *handle, void *addr) {
-  xdl_t *self = (xdl_t *)handle;
+static bool xdl_sym_by_addr(xdl_t *self, uintptr_t offset, xdl_info_t *info, size_t *cursor) {
+  // load .dynsym only once
+  xdl_dynsym_load_once(self);
+  if (NULL == self->dynsym) return false;
+
+  // build the address index only once, symbols hashed by neither table are not exported
+  xdl_addr_index_t *index = &self->dynsym_addr_index;
+  if (xdl_once_enter(self, &index->try_build)) {
+    size_t begin = self->gnu_hash.buckets_cnt > 0 ? self->gnu_hash.symoffset : 0;
+    xdl_addr_index_build(index, self->dynsym, begin, xdl_dynsym_cnt(self), false);
+    xdl_once_leave(self, &index->try_build);
+  }
 
+  // find symbol
+  if (index->built) {
+    // binary search, O(log n)
+    xdl_addr_sym_t *entry = xdl_addr_index_find(index, offset, cursor);
+    if (NULL == entry) return false;
+    info->dli_sname = self->dynstr + entry->name;
+    info->dli_saddr = (void *)(self->load_bias + entry->start);
+    info->dli_ssize = entry->end - entry->start;
+  } else {
+    // the index could not be allocated, O(n)
+    ElfW(Sym) *sym = xdl_sym_by_addr_use_scan(self, offset);
+    if (NULL == sym) return false;
+    info->dli_sname = self->dynstr + sym->st_name;
+    info->dli_saddr = (void *)(self->load_bias + sym->st_value);
+    info->dli_ssize = sym->st_size;
+  }
+  return true;
+}
+
+static bool xdl_dsym_by_addr(xdl_t *self, uintptr_t offset, xdl_info_t *info, size_t *cursor) {
   // load .symtab only once
-  if (!self->symtab_try_load) {
-    self->symtab_try_load = true;
-    if (0 != xdl_symtab_load(self)) return NULL;
+  xdl_symtab_load_once(self);
+  if (NULL == self->symtab) return false;
+
+  // build the address index only once
+  xdl_addr_index_t *index = &self->symtab_addr_index;
+  if (xdl_once_enter(self, &index->try_build)) {
+    xdl_addr_index_build(index, self->symtab, 0, self->symtab_cnt, true);
+    xdl_once_leave(self, &index->try_build);
   }
 
   // find symbol
-  if (NULL == self->symtab) return NULL;
-  uintptr_t offset = (uintptr_t)addr - self->load_bias;
+  if (index->built) {
+    // binary search, O(log n)
+    xdl_addr_sym_t *entry = xdl_addr_index_find(index, offset, cursor);
+    if (NULL == entry || entry->name >= self->strtab_sz) return false;
+    info->dli_sname = self->strtab + entry->name;
+    info->dli_saddr = (void *)(self->load_bias + entry->start);
+    info->dli_ssize = entry->end - entry->start;
+    return true;
+  }
+
+  // the index could not be allocated, O(n)
   for (size_t i = 0; i < self->symtab_cnt; i++) {
     ElfW(Sym) *sym = self->symtab + i;
-    if (xdl_sym_is_match(sym, offset, true)) return sym;
+    if (!xdl_sym_is_match(sym, offset, true) || sym->st_name >= self->strtab_sz) continue;
+    info->dli_sname = self->strtab + sym->st_name;
+    info->dli_saddr = (void *)(self->load_bias + sym->st_value);
+    info->dli_ssize = sym->st_size;
+    return true;
   }
+  return false;
+}
+
+// number of ranges starting at or below addr
+static size_t xdl_addr_cache_upper(xdl_addr_cache_t *self, uintptr_t addr) {
+  size_t lo = 0, hi = self->ranges_cnt;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (self->ranges[mid].start <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static xdl_t *xdl_addr_cache_find(xdl_addr_cache_t *self, uintptr_t addr) {
+  // binary search, O(log n)
+  size_t n = xdl_addr_cache_upper(self, addr);
+  if (n > 0 && addr < self->ranges[n - 1].end) return self->ranges[n - 1].handle;
+
+  // only handles that did not fit into ranges are walked, O(n)
+  if (self->degraded)
+    for (xdl_t *handle = self->handles; NULL != handle; handle = handle->next)
+      if (xdl_elf_is_match(handle->load_bias, handle->dlpi_phdr, handle->dlpi_phnum, addr)) return handle;
 
   return NULL;
 }
 
-int xdl_addr(void *addr, xdl_info_t *info, void **cache) {
-  if (NULL == addr || NULL == info || NULL == cache) return 0;
+static int xdl_addr_cache_insert(xdl_addr_cache_t *self, xdl_t *handle) {
+  size_t load_cnt = 0;
+  for (size_t i = 0; i < handle->dlpi_phnum; i++)
+    if (PT_LOAD == handle->dlpi_phdr[i].p_type && handle->dlpi_phdr[i].p_memsz > 0) load_cnt++;
+
+  if (self->ranges_cnt + load_cnt > self->ranges_cap) {
+    size_t cap = self->ranges_cap > 0 ? self->ranges_cap * 2 : 64;
+    while (cap < self->ranges_cnt + load_cnt) cap *= 2;
+    xdl_addr_range_t *ranges = realloc(self->ranges, cap * sizeof(xdl_addr_range_t));
+    if (NULL == ranges) return -1;
+    self->ranges = ranges;
+    self->ranges_cap = cap;
+  }
+
+  for (size_t i = 0; i < handle->dlpi_phnum; i++) {
+    const ElfW(Phdr) *phdr = &(handle->dlpi_phdr[i]);
+    if (PT_LOAD != phdr->p_type || 0 == phdr->p_memsz) continue;
+
+    uintptr_t start = handle->load_bias + phdr->p_vaddr;
+    size_t n = xdl_addr_cache_upper(self, start);
+    memmove(self->ranges + n + 1, self->ranges + n, (self->ranges_cnt - n) * sizeof(xdl_addr_range_t));
+    self->ranges[n].start = start;
+    self->ranges[n].end = start + phdr->p_memsz;
+    self->ranges[n].handle = handle;
+    self->ranges_cnt++;
+  }
+  return 0;
+}
 
-  memset(info, 0, sizeof(Dl_info));
+static xdl_t *xdl_addr_find_handle(void *addr, void **cache) {
+  xdl_addr_cache_t *self = *((xdl_addr_cache_t **)cache);
+  if (NULL == self) {
+    if (NULL == (self = calloc(1, sizeof(xdl_addr_cache_t)))) return NULL;
+    *(xdl_addr_cache_t **)cache = self;
+  }
 
   // find handle from cache
-  xdl_t *handle = NULL;
-  for (handle = *((xdl_t **)cache); NULL != handle; handle = handle->next)
-    if (xdl_elf_is_match(handle->load_bias, handle->dlpi_phdr, handle->dlpi_phnum, (uintptr_t)addr)) break;
+  xdl_t *handle = xdl_addr_cache_find(self, (uintptr_t)addr);
+  if (NULL != handle) return handle;
 
   // create new handle, save handle to cache
-  if (NULL == handle) {
-    handle = (xdl_t *)xdl_open_by_addr(addr);
-    if (NULL == handle) return 0;
-    handle->next = *(xdl_t **)cache;
-    *(xdl_t **)cache = handle;
-  }
+  handle = (xdl_t *)xdl_open_by_addr(addr);
+  if (NULL == handle) return NULL;
+  handle->next = self->handles;
+  self->handles = handle;
+  if (0 != xdl_addr_cache_insert(self, handle)) self->degraded = true;
+  return handle;
+}
 
+// cursors: positions in the .dynsym and .symtab address indexes, or NULL
+static void xdl_addr_resolve(xdl_t *handle, void *addr, xdl_info_t *info, size_t *cursors) {
   // we have at least: load_bias, pathname, dlpi_phdr, dlpi_phnum
   info->dli_fbase = (void *)handle->load_bias;
   info->dli_fname = handle->pathname;
@@ -820,32 +1566,132 @@ int xdl_addr(void *addr, xdl_info_t *info, void **cache) {
   info->dlpi_phnum = (size_t)handle->dlpi_phnum;
 
   // keep looking for: symbol name, symbol offset, symbol size
-  ElfW(Sym) *sym;
-  if (NULL != (sym = xdl_sym_by_addr((void *)handle, addr))) {
-    info->dli_sname = handle->dynstr + sym->st_name;
-    info->dli_saddr = (void *)(handle->load_bias + sym->st_value);
-    info->dli_ssize = sym->st_size;
-  } else if (NULL != (sym = xdl_dsym_by_addr((void *)handle, addr))) {
-    info->dli_sname = handle->strtab + sym->st_name;
-    info->dli_saddr = (void *)(handle->load_bias + sym->st_value);
-    info->dli_ssize = sym->st_size;
-  }
+  uintptr_t offset = (uintptr_t)addr - handle->load_bias;
+  if (!xdl_sym_by_addr(handle, offset, info, NULL == cursors ? NULL : &cursors[0]))
+    xdl_dsym_by_addr(handle, offset, info, NULL == cursors ? NULL : &cursors[1]);
+}
+
+int xdl_addr(void *addr, xdl_info_t *info, void **cache) {
+  if (NULL == addr || NULL == info || NULL == cache) return 0;
+
+  memset(info, 0, sizeof(xdl_info_t));
 
+  xdl_t *handle = xdl_addr_find_handle(addr, cache);
+  if (NULL == handle) return 0;
+
+  xdl_addr_resolve(handle, addr, info, NULL);
   return 1;
 }
 
+size_t xdl_addr_batch(void *const *addrs, xdl_info_t *infos, size_t cnt, void **cache) {
+  if (NULL == addrs || NULL == infos || NULL == cache) return 0;
+
+  size_t resolved = 0;
+  xdl_t *handle = NULL;
+  size_t cursors[2] = {SIZE_MAX, SIZE_MAX};
+  for (size_t i = 0; i < cnt; i++) {
+    void *addr = addrs[i];
+    xdl_info_t *info = infos + i;
+    memset(info, 0, sizeof(xdl_info_t));
+    if (NULL == addr) continue;
+
+    // sorted addresses stay in one library for long runs, keep its handle and index positions
+    if (NULL == handle ||
+        !xdl_elf_is_match(handle->load_bias, handle->dlpi_phdr, handle->dlpi_phnum, (uintptr_t)addr)) {
+      if (NULL == (handle = xdl_addr_find_handle(addr, cache))) continue;
+      cursors[0] = cursors[1] = SIZE_MAX;
+    }
+
+    xdl_addr_resolve(handle, addr, info, cursors);
+    resolved++;
+  }
+  return resolved;
+}
+
 void xdl_addr_clean(void **cache) {
   if (NULL == cache) return;
 
-  xdl_t *handle = *((xdl_t **)cache);
+  xdl_addr_cache_t *self = *((xdl_addr_cache_t **)cache);
+  if (NULL == self) return;
+
+  xdl_t *handle = self->handles;
   while (NULL != handle) {
     xdl_t *tmp = handle;
     handle = handle->next;
     xdl_close(tmp);
   }
+  if (NULL != self->ranges) free(self->ranges);
+  free(self);
   *cache = NULL;
 }
 
+int xdl_set_symtab_cache_dir(const char *dir) {
+  char *copy = NULL;
+  if (NULL != dir && NULL == (copy = strdup(dir))) return -1;
+
+  char *old = xdl_symtab_cache_dir;
+  xdl_symtab_cache_dir = copy;
+  if (NULL != old) free(old);
+  return 0;
+}
+
+static int xdl_iterate_symbols_in(xdl_t *self, int table, const ElfW(Sym) *syms, size_t cnt, const char *strs,
+                                  size_t strs_sz, xdl_iterate_symbols_cb_t callback, void *arg) {
+  xdl_symbol_t symbol;
+  symbol.table = table;
+  for (size_t i = 0; i < cnt; i++) {
+    const ElfW(Sym) *sym = syms + i;
+    if (XDL_ITERATE_SYMTAB == table ? !XDL_SYMTAB_IS_EXPORT_SYM(sym->st_shndx)
+                                    : !XDL_DYNSYM_IS_EXPORT_SYM(sym->st_shndx))
+      continue;
+    unsigned char type = ELF_ST_TYPE(sym->st_info);
+    if (STT_SECTION == type || STT_FILE == type) continue;
+    if (0 == sym->st_name || sym->st_name >= strs_sz) continue;
+
+    symbol.name = strs + sym->st_name;
+    // TLS symbols have an offset in the TLS block of the ELF, not an address
+    symbol.addr = (void *)(STT_TLS == type ? sym->st_value : self->load_bias + sym->st_value);
+    symbol.size = sym->st_size;
+    symbol.type = type;
+    symbol.bind = ELF_ST_BIND(sym->st_info);
+    int r = callback(&symbol, arg);
+    if (0 != r) return r;
+  }
+  return 0;
+}
+
+int xdl_iterate_symbols(void *handle, int flags, xdl_iterate_symbols_cb_t callback, void *arg) {
+  if (NULL == handle || NULL == callback) return -1;
+
+  xdl_t *self = (xdl_t *)handle;
+  bool found = false;
+  int r = 0;
+
+  if (flags & XDL_ITERATE_DYNSYM) {
+    // load .dynsym only once
+    xdl_dynsym_load_once(self);
+    if (NULL != self->dynsym) {
+      found = true;
+      // .dynstr has no size here, the names come from the linker
+      r = xdl_iterate_symbols_in(self, XDL_ITERATE_DYNSYM, self->dynsym, xdl_dynsym_cnt(self), self->dynstr,
+                                 SIZE_MAX, callback, arg);
+      if (0 != r) return r;
+    }
+  }
+
+  if (flags & XDL_ITERATE_SYMTAB) {
+    // load .symtab only once
+    xdl_symtab_load_once(self);
+    if (NULL != self->symtab) {
+      found = true;
+      r = xdl_iterate_symbols_in(self, XDL_ITERATE_SYMTAB, self->symtab, self->symtab_cnt, self->strtab,
+                                 self->strtab_sz, callback, arg);
+    }
+  }
+
+  return found ? r : -1;
+}
+
 int xdl_iterate_phdr(int (*callback)(struct dl_phdr_info *, size_t, void *), void *data, int flags) {
   if (NULL == callback) return 0;
 
@@ -853,9 +1699,22 @@ int xdl_iterate_phdr(int (*callback)(struct dl_phdr_info *, size_t, void *), voi
 }
 
 int xdl_info(void *handle, int request, void *info) {
-  if (NULL == handle || XDL_DI_DLINFO != request || NULL == info) return -1;
+  if (NULL == handle || NULL == info) return -1;
 
   xdl_t *self = (xdl_t *)handle;
+  if (XDL_DI_SYMTAB_INDEX == request) {
+    // only after xdl_dsym() or xdl_addr() loaded .symtab
+    if (!__atomic_load_n(&self->symtab_try_load, __ATOMIC_ACQUIRE) || NULL == self->symtab) return -1;
+    xdl_symtab_index_info_t *index = (xdl_symtab_index_info_t *)info;
+    index->symtab_cnt = self->symtab_cnt;
+    index->indexed_cnt = self->symtab_indexed_cnt;
+    index->index_sz = NULL == self->symtab_slots
+                          ? 0
+                          : ((size_t)self->symtab_slots_mask + 1) * sizeof(xdl_symtab_slot_t);
+    index->build_ns = self->symtab_index_ns;
+    return 0;
+  }
+  if (XDL_DI_DLINFO != request) return -1;
   xdl_info_t *dlinfo = (xdl_info_t *)info;
 
   dlinfo->dli_fbase = (void *)self->load_bias;
@@ -24,20 +24,21 @@
 #include "xdl_iterate.h"
 
 #include <android/api-level.h>
-#include <ctype.h>
 #include <dlfcn.h>
 #include <elf.h>
-#include <inttypes.h>
 #include <link.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/auxv.h>
 
 #include "xdl.h"
 #include "xdl_linker.h"
+#include "xdl_maps.h"
 #include "xdl_util.h"
 
 /*
@@ -71,46 +72,40 @@ static uintptr_t xdl_iterate_get_min_vaddr(struct dl_phdr_info *info) {
   return min_vaddr;
 }
 
-static int xdl_iterate_open_or_rewind_maps(FILE **maps) {
-  if (NULL == *maps) {
-    *maps = fopen("/proc/self/maps", "r");
-    if (NULL == *maps) return -1;
-  } else
-    rewind(*maps);
-
-  return 0;
-}
-
-static int xdl_iterate_get_pathname_from_maps(uintptr_t base, char *buf, size_t buf_len, FILE **maps) {
-  // open or rewind maps-file
-  if (0 != xdl_iterate_open_or_rewind_maps(maps)) return -1;  // failed
-
-  char line[1024];
-  while (fgets(line, sizeof(line), *maps)) {
-    // check base address
-    uintptr_t start, end;
-    if (2 != sscanf(line, "%" SCNxPTR "-%" SCNxPTR " r", &start, &end)) continue;
-    if (base < start) break;  // failed
-    if (base >= end) continue;
+// one snapshot of /proc/self/maps, read on the first query and kept for the rest of an iteration
+typedef struct {
+  bool try_load;
+  bool loaded;
+  xdl_maps_t maps;
+} xdl_iterate_maps_t;
+
+static int xdl_iterate_get_pathname_from_maps(uintptr_t base, char *buf, size_t buf_len,
+                                              xdl_iterate_maps_t *maps) {
+  // read maps-file only once
+  if (!maps->try_load) {
+    maps->try_load = true;
+    maps->loaded = (0 == xdl_maps_load(&maps->maps));
+  }
+  if (!maps->loaded) return -1;  // failed
 
-    // get pathname
-    char *pathname = strchr(line, '/');
-    if (NULL == pathname) break;  // failed
-    xdl_util_trim_ending(pathname);
+  // check base address
+  const xdl_maps_entry_t *entry = xdl_maps_find(&maps->maps, base);
+  if (NULL == entry) return -1;  // failed
 
-    // found it
-    strlcpy(buf, pathname, buf_len);
-    return 0;  // OK
-  }
+  // get pathname
+  const char *pathname = strchr(entry->pathname, '/');
+  if (NULL == pathname) return -1;  // failed
 
-  return -1;  // failed
+  // found it
+  strlcpy(buf, pathname, buf_len);
+  return 0;  // OK
 }
 
 static int xdl_iterate_by_linker_cb(struct dl_phdr_info *info, size_t size, void *arg) {
   uintptr_t *pkg = (uintptr_t *)arg;
   xdl_iterate_phdr_cb_t cb = (xdl_iterate_phdr_cb_t)*pkg++;
   void *cb_arg = (void *)*pkg++;
-  FILE **maps = (FILE **)*pkg++;
+  xdl_iterate_maps_t *maps = (xdl_iterate_maps_t *)*pkg++;
   uintptr_t linker_load_bias = *pkg++;
   int flags = (int)*pkg;
 
@@ -183,7 +178,7 @@ static int xdl_iterate_by_linker(xdl_iterate_phdr_cb_t cb, void *cb_arg, int fla
   if (NULL == dl_iterate_phdr) return 0;
 
   int api_level = xdl_util_get_api_level();
-  FILE *maps = NULL;
+  xdl_iterate_maps_t maps = {.try_load = false, .loaded = false};
   int r;
 
   // dl_iterate_phdr(3) does NOT contain linker/linker64 when Android version < 8.1 (API level 27).
@@ -202,79 +197,46 @@ static int xdl_iterate_by_linker(xdl_iterate_phdr_cb_t cb, void *cb_arg, int fla
   r = dl_iterate_phdr(xdl_iterate_by_linker_cb, pkg);
   if (__ANDROID_API_L__ == api_level || __ANDROID_API_L_MR1__ == api_level) xdl_linker_unlock();
 
-  if (NULL != maps) fclose(maps);
+  if (maps.loaded) xdl_maps_free(&maps.maps);
   return r;
 }
 
 #if (defined(__arm__) || defined(__i386__)) && __ANDROID_API__ < __ANDROID_API_L__
 static int xdl_iterate_by_maps(xdl_iterate_phdr_cb_t cb, void *cb_arg) {
-  FILE *maps = fopen("/proc/self/maps", "r");
-  if (NULL == maps) return 0;
+  xdl_maps_t maps;
+  if (0 != xdl_maps_load(&maps)) return 0;
 
   int r = 0;
-  char buf1[1024], buf2[1024];
-  char *line = buf1;
-  uintptr_t prev_base = 0;
-  bool try_next_line = false;
-
-  while (fgets(line, sizeof(buf1), maps)) {
+  for (size_t i = 0; i < maps.entries_cnt; i++) {
     // Try to find an ELF which loaded by linker.
-    uintptr_t base, offset;
-    char exec;
-    if (3 != sscanf(line, "%" SCNxPTR "-%*" SCNxPTR " r%*c%cp %" SCNxPTR " ", &base, &exec, &offset)) goto clean;
-
-    if ('-' == exec && 0 == offset) {
-      // r--p
-      prev_base = base;
-      line = (line == buf1 ? buf2 : buf1);
-      try_next_line = true;
-      continue;
-    }
-    else if (exec == 'x') {
-      // r-xp
-      char *pathname = NULL;
-      if (try_next_line && 0 != offset) {
-        char *prev = (line == buf1 ? buf2 : buf1);
-        char *prev_pathname = strchr(prev, '/');
-        if (NULL == prev_pathname) goto clean;
-
-        pathname = strchr(line, '/');
-        if (NULL == pathname) goto clean;
-
-        xdl_util_trim_ending(prev_pathname);
-        xdl_util_trim_ending(pathname);
-        if (0 != strcmp(prev_pathname, pathname)) goto clean;
-
-        // we found the line with r-xp in the next line
-        base = prev_base;
-        offset = 0;
-      }
-
-      if (0 != offset) goto clean;
-
-      // get pathname
-      if (NULL == pathname) {
-        pathname = strchr(line, '/');
-        if (NULL == pathname) goto clean;
-        xdl_util_trim_ending(pathname);
-      }
-
-      if (0 != memcmp((void *)base, ELFMAG, SELFMAG)) goto clean;
-      ElfW(Ehdr) *ehdr = (ElfW(Ehdr) *)base;
-      struct dl_phdr_info info;
-      info.dlpi_name = pathname;
-      info.dlpi_phdr = (const ElfW(Phdr) *)(base + ehdr->e_phoff);
-      info.dlpi_phnum = ehdr->e_phnum;
-
-      // callback
-      if (0 != (r = xdl_iterate_do_callback(cb, cb_arg, base, pathname, NULL))) break;
+    const xdl_maps_entry_t *entry = &maps.entries[i];
+    int rxp = XDL_MAPS_PERM_R | XDL_MAPS_PERM_X | XDL_MAPS_PERM_P;
+    if (rxp != (entry->perms & rxp)) continue;
+
+    // r-xp
+    uintptr_t base = entry->start;
+    if (0 != entry->offset) {
+      // the r--p line before it may start the ELF
+      if (0 == i) continue;
+      const xdl_maps_entry_t *prev = &maps.entries[i - 1];
+      if ((XDL_MAPS_PERM_R | XDL_MAPS_PERM_P) != (prev->perms & rxp)) continue;
+      if (0 != prev->offset || 0 != strcmp(prev->pathname, entry->pathname)) continue;
+
+      // we found the line with r-xp in the next line
+      base = prev->start;
     }
 
- clean:
-    try_next_line = false;
+    // get pathname
+    const char *pathname = strchr(entry->pathname, '/');
+    if (NULL == pathname) continue;
+
+    if (0 != memcmp((void *)base, ELFMAG, SELFMAG)) continue;
+
+    // callback
+    if (0 != (r = xdl_iterate_do_callback(cb, cb_arg, base, pathname, NULL))) break;
   }
 
-  fclose(maps);
+  xdl_maps_free(&maps);
   return r;
 }
 #endif
@@ -289,9 +251,268 @@ int xdl_iterate_phdr_impl(xdl_iterate_phdr_cb_t cb, void *cb_arg, int flags) {
   return xdl_iterate_by_linker(cb, cb_arg, flags);
 }
 
+// one ELF of the snapshot, as xdl_iterate_phdr_impl() reported it
+typedef struct {
+  uintptr_t load_bias;
+  const ElfW(Phdr) *dlpi_phdr;
+  ElfW(Half) dlpi_phnum;
+  char *pathname;
+  size_t next;  // next ELF in the same name bucket, in load order, SIZE_MAX for none
+} xdl_iterate_obj_t;
+
+// one PT_LOAD segment of a snapshot ELF
+typedef struct {
+  uintptr_t start;
+  uintptr_t end;
+  size_t obj;
+} xdl_iterate_seg_t;
+
+// the loaded ELFs, valid for as long as dl_iterate_phdr() reports the same dlpi_adds/dlpi_subs;
+// never changed once built, so it is read without the lock for as long as a reference is held
+typedef struct {
+  size_t refs;  // xdl_iterate_snapshot and the callers iterating it, under xdl_iterate_snapshot_lock
+  unsigned long long adds;
+  unsigned long long subs;
+  xdl_iterate_obj_t *objs;
+  size_t objs_cnt;
+  size_t objs_cap;
+  size_t *buckets;  // first ELF of each basename hash bucket, SIZE_MAX for none
+  size_t buckets_mask;
+  xdl_iterate_seg_t *segs;  // sorted by start
+  size_t segs_cnt;
+  bool failed;  // an allocation failed while collecting
+} xdl_iterate_snapshot_t;
+
+static xdl_iterate_snapshot_t *xdl_iterate_snapshot = NULL;
+static pthread_mutex_t xdl_iterate_snapshot_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int xdl_iterate_counters_cb(struct dl_phdr_info *info, size_t size, void *arg) {
+  // the counters were added in Android 11
+  if (size < offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs)) return -1;
+
+  unsigned long long *counters = (unsigned long long *)arg;
+  counters[0] = info->dlpi_adds;
+  counters[1] = info->dlpi_subs;
+  return 1;
+}
+
+// only looks at the first ELF, dl_iterate_phdr() reports the same counters for all of them
+static bool xdl_iterate_get_counters(unsigned long long *counters) {
+  if (NULL == dl_iterate_phdr) return false;
+  return 1 == dl_iterate_phdr(xdl_iterate_counters_cb, counters);
+}
+
+static const char *xdl_iterate_basename(const char *pathname) {
+  const char *basename = strrchr(pathname, '/');
+  return NULL == basename ? pathname : basename + 1;
+}
+
+static uint32_t xdl_iterate_name_hash(const char *name) {
+  uint32_t h = 5381;
+  while (*name) h += (h << 5) + (uint8_t)*name++;
+  return h;
+}
+
+static void xdl_iterate_snapshot_free(xdl_iterate_snapshot_t *self) {
+  for (size_t i = 0; i < self->objs_cnt; i++) free(self->objs[i].pathname);
+  if (NULL != self->objs) free(self->objs);
+  if (NULL != self->buckets) free(self->buckets);
+  if (NULL != self->segs) free(self->segs);
+  free(self);
+}
+
+static int xdl_iterate_snapshot_collect_cb(struct dl_phdr_info *info, size_t size, void *arg) {
+  (void)size;
+
+  xdl_iterate_snapshot_t *self = (xdl_iterate_snapshot_t *)arg;
+  if (self->objs_cnt == self->objs_cap) {
+    size_t new_cap = 0 == self->objs_cap ? 256 : self->objs_cap * 2;
+    xdl_iterate_obj_t *new_objs = realloc(self->objs, new_cap * sizeof(xdl_iterate_obj_t));
+    if (NULL == new_objs) goto failed;
+    self->objs = new_objs;
+    self->objs_cap = new_cap;
+  }
+
+  xdl_iterate_obj_t *obj = &self->objs[self->objs_cnt];
+  if (NULL == (obj->pathname = strdup(info->dlpi_name))) goto failed;
+  obj->load_bias = info->dlpi_addr;
+  obj->dlpi_phdr = info->dlpi_phdr;
+  obj->dlpi_phnum = info->dlpi_phnum;
+  obj->next = SIZE_MAX;
+  self->objs_cnt++;
+
+  for (size_t i = 0; i < info->dlpi_phnum; i++)
+    if (PT_LOAD == info->dlpi_phdr[i].p_type) self->segs_cnt++;
+  return 0;
+
+failed:
+  self->failed = true;
+  return 1;
+}
+
+static int xdl_iterate_seg_cmp(const void *a, const void *b) {
+  uintptr_t sa = ((const xdl_iterate_seg_t *)a)->start, sb = ((const xdl_iterate_seg_t *)b)->start;
+  return sa < sb ? -1 : (sa > sb ? 1 : 0);
+}
+
+static int xdl_iterate_snapshot_index(xdl_iterate_snapshot_t *self) {
+  // basename hash buckets, at most half full; chains keep the load order
+  size_t buckets_cnt = 16;
+  while (buckets_cnt < self->objs_cnt * 2) buckets_cnt *= 2;
+  if (NULL == (self->buckets = malloc(buckets_cnt * sizeof(size_t)))) return -1;
+  self->buckets_mask = buckets_cnt - 1;
+  for (size_t i = 0; i < buckets_cnt; i++) self->buckets[i] = SIZE_MAX;
+  for (size_t i = self->objs_cnt; i > 0; i--) {
+    xdl_iterate_obj_t *obj = &self->objs[i - 1];
+    size_t *bucket = &self->buckets[xdl_iterate_name_hash(xdl_iterate_basename(obj->pathname)) &
+                                    self->buckets_mask];
+    obj->next = *bucket;
+    *bucket = i - 1;
+  }
+
+  // PT_LOAD segments sorted by address
+  if (NULL == (self->segs = malloc((self->segs_cnt + 1) * sizeof(xdl_iterate_seg_t)))) return -1;
+  size_t segs_cnt = 0;
+  for (size_t i = 0; i < self->objs_cnt; i++) {
+    xdl_iterate_obj_t *obj = &self->objs[i];
+    for (size_t j = 0; j < obj->dlpi_phnum; j++) {
+      const ElfW(Phdr) *phdr = &obj->dlpi_phdr[j];
+      if (PT_LOAD != phdr->p_type) continue;
+      self->segs[segs_cnt].start = obj->load_bias + phdr->p_vaddr;
+      self->segs[segs_cnt].end = obj->load_bias + phdr->p_vaddr + phdr->p_memsz;
+      self->segs[segs_cnt].obj = i;
+      segs_cnt++;
+    }
+  }
+  self->segs_cnt = segs_cnt;
+  qsort(self->segs, self->segs_cnt, sizeof(xdl_iterate_seg_t), xdl_iterate_seg_cmp);
+  return 0;
+}
+
+// the current snapshot with a reference taken, rebuilt first when the linker loaded or unloaded
+// anything since it was taken, NULL when there is none. dl_iterate_phdr() takes the linker's lock,
+// so it never runs with xdl_iterate_snapshot_lock held: a constructor that ends up in here while
+// another thread walks the ELFs would deadlock against it otherwise
+static xdl_iterate_snapshot_t *xdl_iterate_snapshot_acquire(void) {
+  unsigned long long before[2], after[2];
+  if (!xdl_iterate_get_counters(before)) return NULL;
+
+  pthread_mutex_lock(&xdl_iterate_snapshot_lock);
+  xdl_iterate_snapshot_t *self = xdl_iterate_snapshot;
+  if (NULL != self && self->adds == before[0] && self->subs == before[1]) {
+    self->refs++;
+    pthread_mutex_unlock(&xdl_iterate_snapshot_lock);
+    return self;
+  }
+  pthread_mutex_unlock(&xdl_iterate_snapshot_lock);
+
+  if (NULL == (self = calloc(1, sizeof(xdl_iterate_snapshot_t)))) return NULL;
+  xdl_iterate_by_linker(xdl_iterate_snapshot_collect_cb, self, XDL_DEFAULT);
+
+  // keep it only when nothing changed during the walk
+  if (self->failed || !xdl_iterate_get_counters(after) || after[0] != before[0] || after[1] != before[1] ||
+      0 != xdl_iterate_snapshot_index(self)) {
+    xdl_iterate_snapshot_free(self);
+    return NULL;
+  }
+  self->adds = before[0];
+  self->subs = before[1];
+  self->refs = 1;
+
+  // the counters only grow, a thread that built from older ones does not replace a newer snapshot
+  xdl_iterate_snapshot_t *old = NULL;
+  pthread_mutex_lock(&xdl_iterate_snapshot_lock);
+  if (NULL == xdl_iterate_snapshot ||
+      (before[0] >= xdl_iterate_snapshot->adds && before[1] >= xdl_iterate_snapshot->subs)) {
+    old = xdl_iterate_snapshot;
+    if (NULL != old && 0 != --old->refs) old = NULL;
+    xdl_iterate_snapshot = self;
+    self->refs++;
+  }
+  pthread_mutex_unlock(&xdl_iterate_snapshot_lock);
+  if (NULL != old) xdl_iterate_snapshot_free(old);
+  return self;
+}
+
+static void xdl_iterate_snapshot_release(xdl_iterate_snapshot_t *self) {
+  pthread_mutex_lock(&xdl_iterate_snapshot_lock);
+  bool last = 0 == --self->refs;
+  pthread_mutex_unlock(&xdl_iterate_snapshot_lock);
+  if (last) xdl_iterate_snapshot_free(self);
+}
+
+// called without xdl_iterate_snapshot_lock, cb may load libraries or come back in here
+static int xdl_iterate_snapshot_callback(xdl_iterate_phdr_cb_t cb, void *cb_arg, const xdl_iterate_obj_t *obj) {
+  struct dl_phdr_info info;
+  memset(&info, 0, sizeof(info));
+  info.dlpi_addr = obj->load_bias;
+  info.dlpi_name = obj->pathname;
+  info.dlpi_phdr = obj->dlpi_phdr;
+  info.dlpi_phnum = obj->dlpi_phnum;
+  return cb(&info, sizeof(info), cb_arg);
+}
+
+int xdl_iterate_find_by_name(const char *filename, xdl_iterate_phdr_cb_t cb, void *cb_arg) {
+  xdl_iterate_snapshot_t *self = xdl_iterate_snapshot_acquire();
+  if (NULL == self) return -1;
+
+  // ELFs with the same basename first; a name without '/' has to be a basename, so its misses
+  // are answered from that bucket alone. Only paths go on to every ELF, for the ones that match
+  // as a suffix of another name
+  const char *basename = xdl_iterate_basename(filename);
+  int r = 0;
+  for (size_t i = self->buckets[xdl_iterate_name_hash(basename) & self->buckets_mask]; SIZE_MAX != i;
+       i = self->objs[i].next) {
+    if (0 != strcmp(xdl_iterate_basename(self->objs[i].pathname), basename)) continue;
+    if (0 != (r = xdl_iterate_snapshot_callback(cb, cb_arg, &self->objs[i]))) goto end;
+  }
+  if (basename == filename) goto end;
+  for (size_t i = 0; i < self->objs_cnt; i++) {
+    if (0 == strcmp(xdl_iterate_basename(self->objs[i].pathname), basename)) continue;
+    if (0 != (r = xdl_iterate_snapshot_callback(cb, cb_arg, &self->objs[i]))) goto end;
+  }
+
+end:
+  xdl_iterate_snapshot_release(self);
+  return r;
+}
+
+int xdl_iterate_snapshot_phdr(xdl_iterate_phdr_cb_t cb, void *cb_arg) {
+  xdl_iterate_snapshot_t *self = xdl_iterate_snapshot_acquire();
+  if (NULL == self) return -1;
+
+  int r = 0;
+  for (size_t i = 0; i < self->objs_cnt; i++)
+    if (0 != (r = xdl_iterate_snapshot_callback(cb, cb_arg, &self->objs[i]))) break;
+
+  xdl_iterate_snapshot_release(self);
+  return r;
+}
+
+int xdl_iterate_find_by_addr(uintptr_t addr, xdl_iterate_phdr_cb_t cb, void *cb_arg) {
+  xdl_iterate_snapshot_t *self = xdl_iterate_snapshot_acquire();
+  if (NULL == self) return -1;
+
+  // the last segment starting at or below addr
+  size_t lo = 0, hi = self->segs_cnt;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (self->segs[mid].start <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  int r = 0;
+  if (lo > 0 && addr < self->segs[lo - 1].end)
+    r = xdl_iterate_snapshot_callback(cb, cb_arg, &self->objs[self->segs[lo - 1].obj]);
+
+  xdl_iterate_snapshot_release(self);
+  return r;
+}
+
 int xdl_iterate_get_full_pathname(uintptr_t base, char *buf, size_t buf_len) {
-  FILE *maps = NULL;
+  xdl_iterate_maps_t maps = {.try_load = false, .loaded = false};
   int r = xdl_iterate_get_pathname_from_maps(base, buf, buf_len, &maps);
-  if (NULL != maps) fclose(maps);
+  if (maps.loaded) xdl_maps_free(&maps.maps);
   return r;
 }
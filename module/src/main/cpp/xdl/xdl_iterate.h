@@ -34,6 +34,16 @@ extern "C" {
 typedef int (*xdl_iterate_phdr_cb_t)(struct dl_phdr_info *info, size_t size, void *arg);
 int xdl_iterate_phdr_impl(xdl_iterate_phdr_cb_t cb, void *cb_arg, int flags);
 
+// Call cb for the loaded ELFs that may be named filename or contain addr, from a snapshot that
+// is rebuilt only when the dlpi_adds/dlpi_subs counters of dl_iterate_phdr() change. Return -1
+// when the linker does not report them (before Android 11), the caller then has to iterate.
+// cb runs with no lock of xdl held, it may load libraries or call back in here.
+int xdl_iterate_find_by_name(const char *filename, xdl_iterate_phdr_cb_t cb, void *cb_arg);
+int xdl_iterate_find_by_addr(uintptr_t addr, xdl_iterate_phdr_cb_t cb, void *cb_arg);
+
+// xdl_iterate_phdr_impl(cb, cb_arg, XDL_DEFAULT) over the same snapshot, -1 when there is none
+int xdl_iterate_snapshot_phdr(xdl_iterate_phdr_cb_t cb, void *cb_arg);
+
 int xdl_iterate_get_full_pathname(uintptr_t base, char *buf, size_t buf_len);
 
 #ifdef __cplusplus
@@ -25,6 +25,7 @@
 
 #include <ctype.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -36,11 +37,13 @@
 #include "xdl_util.h"
 
 // LZMA library pathname & symbol names
+#ifndef XDL_LZMA_PATHNAME
 #ifndef __LP64__
 #define XDL_LZMA_PATHNAME "/system/lib/liblzma.so"
 #else
 #define XDL_LZMA_PATHNAME "/system/lib64/liblzma.so"
 #endif
+#endif
 #define XDL_LZMA_SYM_CRCGEN     "CrcGenerateTable"
 #define XDL_LZMA_SYM_CRC64GEN   "Crc64GenerateTable"
 #define XDL_LZMA_SYM_CONSTRUCT  "XzUnpacker_Construct"
@@ -85,7 +88,7 @@ static xdl_lzma_free_t xdl_lzma_free = NULL;
 static void *xdl_lzma_code = NULL;
 
 // LZMA init
-static void xdl_lzma_init() {
+static void xdl_lzma_init(void) {
   void *lzma = xdl_open(XDL_LZMA_PATHNAME, XDL_TRY_FORCE_LOAD);
   if (NULL == lzma) return;
 
@@ -116,6 +119,48 @@ static void xdl_lzma_internal_free(ISzAllocPtr p, void *address) {
   free(address);
 }
 
+// XZ variable-length integer, 7 bits per byte, at most 9 bytes
+static int xdl_lzma_read_vli(const uint8_t *buf, size_t buf_size, size_t *offset, uint64_t *value) {
+  *value = 0;
+  for (size_t i = 0; i < 9 && *offset < buf_size; i++) {
+    uint8_t byte = buf[(*offset)++];
+    *value |= (uint64_t)(byte & 0x7F) << (i * 7);
+    if (0 == (byte & 0x80)) return 0;
+  }
+  return -1;
+}
+
+// Total uncompressed size recorded in the index of the last XZ stream in src, 0 when it cannot be
+// read. The index sits right before the 12-byte stream footer, whose backward size locates it.
+static size_t xdl_lzma_get_uncompressed_size(const uint8_t *src, size_t src_size) {
+  // skip stream padding
+  while (src_size >= 4 && 0 == (src[src_size - 1] | src[src_size - 2] | src[src_size - 3] | src[src_size - 4]))
+    src_size -= 4;
+  if (src_size < 12) return 0;
+
+  // stream footer: CRC32, backward size, stream flags, "YZ"
+  const uint8_t *footer = src + src_size - 12;
+  if ('Y' != footer[10] || 'Z' != footer[11]) return 0;
+  uint64_t index_size = ((uint64_t)footer[4] | (uint64_t)footer[5] << 8 | (uint64_t)footer[6] << 16 |
+                         (uint64_t)footer[7] << 24) + 1;
+  index_size *= 4;
+  if (index_size > src_size - 12) return 0;
+
+  // index: indicator, number of records, then (unpadded size, uncompressed size) per block
+  const uint8_t *index = footer - index_size;
+  size_t offset = 0;
+  uint64_t records, unpadded, uncompressed, total = 0;
+  if (0x00 != index[offset++]) return 0;
+  if (0 != xdl_lzma_read_vli(index, (size_t)index_size, &offset, &records)) return 0;
+  for (uint64_t i = 0; i < records; i++) {
+    if (0 != xdl_lzma_read_vli(index, (size_t)index_size, &offset, &unpadded)) return 0;
+    if (0 != xdl_lzma_read_vli(index, (size_t)index_size, &offset, &uncompressed)) return 0;
+    if (uncompressed > SIZE_MAX - total) return 0;
+    total += uncompressed;
+  }
+  return (size_t)total;
+}
+
 int xdl_lzma_decompress(uint8_t *src, size_t src_size, uint8_t **dst, size_t *dst_size) {
   size_t src_offset = 0;
   size_t dst_offset = 0;
@@ -126,24 +171,38 @@ int xdl_lzma_decompress(uint8_t *src, size_t src_size, uint8_t **dst, size_t *ds
   ECoderStatus status;
   int api_level = xdl_util_get_api_level();
 
-  // init and check
-  static bool inited = false;
-  if (!inited) {
-    xdl_lzma_init();
-    inited = true;
-  }
+  // init and check, handles on different threads may get here together
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, xdl_lzma_init);
   if (NULL == xdl_lzma_code) return -1;
 
   xdl_lzma_construct(&state, &alloc);
 
-  *dst_size = 2 * src_size;
+  // allocate the exact size named by the XZ index once, only grow when it is missing or wrong
+  size_t init_size = xdl_lzma_get_uncompressed_size(src, src_size);
+  if (0 == init_size) init_size = 4 * src_size;
+  *dst_size = 0;
   *dst = NULL;
+  bool progress = false;
   do {
-    *dst_size *= 2;
-    if (NULL == (*dst = realloc(*dst, *dst_size))) {
+    // a full buffer is fine as long as the decoder still moves on: with the exact size it has
+    // yet to read the block padding, the index and the footer
+    if (!progress && dst_offset < *dst_size) {
+      free(*dst);
       xdl_lzma_free(&state);
       return -1;
     }
+    if (!progress) {
+      size_t new_size = 0 == *dst_size ? init_size : *dst_size * 2;
+      uint8_t *new_dst = realloc(*dst, new_size);
+      if (NULL == new_dst) {
+        free(*dst);
+        xdl_lzma_free(&state);
+        return -1;
+      }
+      *dst = new_dst;
+      *dst_size = new_size;
+    }
 
     src_remaining = src_size - src_offset;
     dst_remaining = *dst_size - dst_offset;
@@ -166,6 +225,7 @@ int xdl_lzma_decompress(uint8_t *src, size_t src_size, uint8_t **dst, size_t *ds
 
     src_offset += src_remaining;
     dst_offset += dst_remaining;
+    progress = src_remaining > 0 || dst_remaining > 0;
   } while (status == CODER_STATUS_NOT_FINISHED);
 
   xdl_lzma_free(&state);
@@ -175,7 +235,10 @@ int xdl_lzma_decompress(uint8_t *src, size_t src_size, uint8_t **dst, size_t *ds
     return -1;
   }
 
+  if (dst_offset > 0 && dst_offset < *dst_size) {
+    uint8_t *new_dst = realloc(*dst, dst_offset);
+    if (NULL != new_dst) *dst = new_dst;
+  }
   *dst_size = dst_offset;
-  *dst = realloc(*dst, *dst_size);
   return 0;
 }
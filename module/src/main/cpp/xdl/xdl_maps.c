@@ -0,0 +1,151 @@
+#include "xdl_maps.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "xdl_util.h"
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wgnu-statement-expression"
+
+// the whole file, read with large read()s into one growing buffer
+static char *xdl_maps_read(size_t *len) {
+  int fd = XDL_UTIL_TEMP_FAILURE_RETRY(open("/proc/self/maps", O_RDONLY | O_CLOEXEC));
+  if (fd < 0) return NULL;
+
+  size_t cap = 256 * 1024, sz = 0;
+  char *buf = malloc(cap);
+  while (NULL != buf) {
+    if (cap - sz < 64 * 1024) {
+      char *new_buf = realloc(buf, cap * 2);
+      if (NULL == new_buf) {
+        free(buf);
+        buf = NULL;
+        break;
+      }
+      buf = new_buf;
+      cap *= 2;
+    }
+    ssize_t n = XDL_UTIL_TEMP_FAILURE_RETRY(read(fd, buf + sz, cap - sz - 1));
+    if (n < 0) {
+      free(buf);
+      buf = NULL;
+    } else if (0 == n) {
+      buf[sz] = '\0';
+      *len = sz;
+      break;
+    } else {
+      sz += (size_t)n;
+    }
+  }
+
+  close(fd);
+  return buf;
+}
+
+#pragma clang diagnostic pop
+
+static const char *xdl_maps_parse_hex(const char *p, uintptr_t *value) {
+  const char *begin = p;
+  uintptr_t v = 0;
+  for (;; p++) {
+    char c = *p;
+    if (c >= '0' && c <= '9')
+      v = v << 4 | (uintptr_t)(c - '0');
+    else if (c >= 'a' && c <= 'f')
+      v = v << 4 | (uintptr_t)(c - 'a' + 10);
+    else
+      break;
+  }
+  *value = v;
+  return p == begin ? NULL : p;
+}
+
+static const char *xdl_maps_skip_field(const char *p) {
+  while (' ' != *p && '\n' != *p && '\0' != *p) p++;
+  while (' ' == *p) p++;
+  return p;
+}
+
+// "start-end perms offset dev inode pathname", the pathname may be missing or contain spaces
+static bool xdl_maps_parse_line(char *line, char *eol, xdl_maps_entry_t *entry) {
+  const char *p = line;
+  if (NULL == (p = xdl_maps_parse_hex(p, &entry->start)) || '-' != *p++) return false;
+  if (NULL == (p = xdl_maps_parse_hex(p, &entry->end)) || ' ' != *p++) return false;
+  if (eol - p < 5) return false;
+  entry->perms = ('r' == p[0] ? XDL_MAPS_PERM_R : 0) | ('w' == p[1] ? XDL_MAPS_PERM_W : 0) |
+                 ('x' == p[2] ? XDL_MAPS_PERM_X : 0) | ('p' == p[3] ? XDL_MAPS_PERM_P : 0);
+  p = xdl_maps_skip_field(p);
+  if (NULL == (p = xdl_maps_parse_hex(p, &entry->offset))) return false;
+  p = xdl_maps_skip_field(xdl_maps_skip_field(xdl_maps_skip_field(p)));  // offset, dev, inode
+
+  // pathname up to the end of the line, without trailing spaces
+  char *end = eol;
+  while (end > p && ' ' == *(end - 1)) end--;
+  *end = '\0';
+  entry->pathname = p;
+  entry->pathname_len = (size_t)(end - p);
+  return true;
+}
+
+static int xdl_maps_entry_cmp(const void *a, const void *b) {
+  const xdl_maps_entry_t *x = (const xdl_maps_entry_t *)a, *y = (const xdl_maps_entry_t *)b;
+  return x->start < y->start ? -1 : (x->start > y->start ? 1 : 0);
+}
+
+int xdl_maps_load(xdl_maps_t *self) {
+  memset(self, 0, sizeof(xdl_maps_t));
+
+  size_t len = 0;
+  if (NULL == (self->buf = xdl_maps_read(&len))) return -1;
+
+  size_t lines = 0;
+  for (const char *p = self->buf; NULL != (p = memchr(p, '\n', len - (size_t)(p - self->buf))); p++) lines++;
+  if (NULL == (self->entries = malloc((lines + 1) * sizeof(xdl_maps_entry_t)))) {
+    xdl_maps_free(self);
+    return -1;
+  }
+
+  // parse in place, each line's newline becomes the end of its pathname
+  bool sorted = true;
+  for (char *line = self->buf; '\0' != *line;) {
+    char *eol = strchr(line, '\n');
+    if (NULL == eol) eol = line + strlen(line);
+    bool last = '\0' == *eol;
+
+    xdl_maps_entry_t *entry = &self->entries[self->entries_cnt];
+    if (xdl_maps_parse_line(line, eol, entry)) {
+      if (self->entries_cnt > 0 && entry->start < self->entries[self->entries_cnt - 1].start) sorted = false;
+      self->entries_cnt++;
+    }
+    if (last) break;
+    line = eol + 1;
+  }
+
+  // the kernel lists mappings in address order, but lookups must not depend on it
+  if (!sorted) qsort(self->entries, self->entries_cnt, sizeof(xdl_maps_entry_t), xdl_maps_entry_cmp);
+  return 0;
+}
+
+void xdl_maps_free(xdl_maps_t *self) {
+  if (NULL != self->buf) free(self->buf);
+  if (NULL != self->entries) free(self->entries);
+  memset(self, 0, sizeof(xdl_maps_t));
+}
+
+const xdl_maps_entry_t *xdl_maps_find(const xdl_maps_t *self, uintptr_t addr) {
+  // last mapping starting at or below addr
+  size_t lo = 0, hi = self->entries_cnt;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (self->entries[mid].start <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (0 == lo || addr >= self->entries[lo - 1].end) return NULL;
+  return &self->entries[lo - 1];
+}
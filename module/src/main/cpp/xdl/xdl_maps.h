@@ -0,0 +1,42 @@
+#ifndef IO_HEXHACKING_XDL_MAPS
+#define IO_HEXHACKING_XDL_MAPS
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XDL_MAPS_PERM_R 0x01
+#define XDL_MAPS_PERM_W 0x02
+#define XDL_MAPS_PERM_X 0x04
+#define XDL_MAPS_PERM_P 0x08  // private (copy on write), as opposed to shared
+
+typedef struct {
+  uintptr_t start;
+  uintptr_t end;
+  uintptr_t offset;
+  const char *pathname;  // points into the snapshot, "" for anonymous mappings
+  size_t pathname_len;
+  int perms;             // XDL_MAPS_PERM_*
+} xdl_maps_entry_t;
+
+// /proc/self/maps read in one go, entries sorted by start address
+typedef struct {
+  char *buf;
+  xdl_maps_entry_t *entries;
+  size_t entries_cnt;
+} xdl_maps_t;
+
+int xdl_maps_load(xdl_maps_t *self);
+void xdl_maps_free(xdl_maps_t *self);
+
+// the mapping that contains addr, NULL if none does
+const xdl_maps_entry_t *xdl_maps_find(const xdl_maps_t *self, uintptr_t addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,478 @@
+// Runs il2cpp_dump() against the synthetic libil2cpp.so from fake_il2cpp.cpp and reports
+// throughput and memory, so changes to the dump engine can be measured without a device.
+//
+//   il2cpp_bench [--classes N] [--iterations N] [--workers N] [--format text|bin] ...
+//
+// The library is loaded with dlopen() and then bound through xdl_open()/xdl_sym() exactly
+// like on a device. Run with --help for every option.
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dlfcn.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fake_il2cpp.h"
+#include "il2cpp_dump.h"
+#include "dump_stats.h"
+#include "load_watcher.h"
+#include "xdl.h"
+#include "xdl_bench.h"
+
+struct BenchOptions {
+    std::string out_dir = "bench-out";
+    std::string library = FAKE_IL2CPP_PATH;
+    FakeIl2CppSpec spec{12, 20000, 6, 8, 4, 2, 1};
+    int iterations = 5;
+    DumpConfig config;
+    // run an xdl benchmark instead of dumping
+    bool symtab = false;
+    bool addr = false;
+    bool open = false;
+    bool symbols = false;
+    int stress_threads = 0;
+    bool symtab_cache = false;
+    bool load_wait = false;
+    // start the fake VM only after il2cpp_api_init() is waiting, 1 polls for it, 2 hooks il2cpp_init
+    int vm_start = 0;
+};
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --out DIR          dump directory, files/ is created inside (default bench-out)\n"
+            "  --lib PATH         fake libil2cpp.so to load (default: the one built alongside)\n"
+            "  --images N         images, mscorlib included (default 12)\n"
+            "  --classes N        generated classes across all images (default 20000)\n"
+            "  --fields N         fields per class (default 6)\n"
+            "  --methods N        methods per class (default 8)\n"
+            "  --params N         maximum parameters per method (default 4)\n"
+            "  --properties N     properties per class (default 2)\n"
+            "  --seed N           generator seed (default 1)\n"
+            "  --iterations N     timed dumps (default 5)\n"
+            "  --workers N        render threads, 0 picks one per big core (default 0)\n"
+            "  --format text|bin  dump.cs or dump.bin (default text)\n"
+            "  --gzip N           compress dump.cs at level N\n"
+            "  --incremental      keep dump.manifest, so dumps after the first reuse images\n"
+            "  --no-stats         do not write dump_stats.json\n"
+            "  --filter FILE      dump_filter.conf rules to apply\n"
+            "  --symtab           benchmark xdl_dsym() over the .symtab of libil2cpp.so instead\n"
+            "  --addr             benchmark xdl_addr() over the .symtab of libil2cpp.so instead\n"
+            "  --open             benchmark xdl_open() of libil2cpp.so and of a missing library instead\n"
+            "  --symbols          benchmark xdl_iterate_symbols() over every loaded library instead\n"
+            "  --stress N         look symbols up from N threads sharing each libil2cpp.so handle instead,\n"
+            "                     one fresh handle per iteration\n"
+            "  --symtab-cache     load the .gnu_debugdata of a stripped copy of the symbols twice through the\n"
+            "                     xdl symtab cache, checking the second load maps the cache\n"
+            "  --load-wait        time how long load_watcher_wait() takes to see libil2cpp.so after it is\n"
+            "                     dlopen()ed, polling and woken like by the dlopen hooks, once per iteration\n"
+            "  --vm-start poll|hook  call il2cpp_init only once il2cpp_api_init() waits for it and time how\n"
+            "                     long it takes to notice, polling or woken like by the il2cpp_init hook\n",
+            argv0);
+}
+
+static bool parse_uint(const char *text, uint64_t max, uint64_t &value) {
+    char *end = nullptr;
+    errno = 0;
+    auto parsed = strtoull(text, &end, 0);
+    if (errno != 0 || end == text || *end != '\0' || parsed > max) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+static bool read_filter(const char *path, DumpFilter &filter) {
+    auto fp = fopen(path, "re");
+    if (!fp) {
+        return false;
+    }
+    std::string text;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        text.append(buffer, n);
+    }
+    fclose(fp);
+    filter.parse(text);
+    return true;
+}
+
+static bool parse_options(int argc, char **argv, BenchOptions &options) {
+    enum {
+        OPT_OUT = 1, OPT_LIB, OPT_IMAGES, OPT_CLASSES, OPT_FIELDS, OPT_METHODS, OPT_PARAMS, OPT_PROPERTIES,
+        OPT_SEED, OPT_ITERATIONS, OPT_WORKERS, OPT_FORMAT, OPT_GZIP, OPT_INCREMENTAL, OPT_NO_STATS, OPT_FILTER,
+        OPT_SYMTAB, OPT_ADDR, OPT_OPEN, OPT_SYMBOLS, OPT_STRESS, OPT_SYMTAB_CACHE, OPT_LOAD_WAIT, OPT_VM_START, OPT_HELP,
+    };
+    static const option kOptions[] = {
+            {"out",         required_argument, nullptr, OPT_OUT},
+            {"lib",         required_argument, nullptr, OPT_LIB},
+            {"images",      required_argument, nullptr, OPT_IMAGES},
+            {"classes",     required_argument, nullptr, OPT_CLASSES},
+            {"fields",      required_argument, nullptr, OPT_FIELDS},
+            {"methods",     required_argument, nullptr, OPT_METHODS},
+            {"params",      required_argument, nullptr, OPT_PARAMS},
+            {"properties",  required_argument, nullptr, OPT_PROPERTIES},
+            {"seed",        required_argument, nullptr, OPT_SEED},
+            {"iterations",  required_argument, nullptr, OPT_ITERATIONS},
+            {"workers",     required_argument, nullptr, OPT_WORKERS},
+            {"format",      required_argument, nullptr, OPT_FORMAT},
+            {"gzip",        required_argument, nullptr, OPT_GZIP},
+            {"incremental", no_argument,       nullptr, OPT_INCREMENTAL},
+            {"no-stats",    no_argument,       nullptr, OPT_NO_STATS},
+            {"filter",      required_argument, nullptr, OPT_FILTER},
+            {"symtab",      no_argument,       nullptr, OPT_SYMTAB},
+            {"addr",        no_argument,       nullptr, OPT_ADDR},
+            {"open",        no_argument,       nullptr, OPT_OPEN},
+            {"symbols",     no_argument,       nullptr, OPT_SYMBOLS},
+            {"stress",      required_argument, nullptr, OPT_STRESS},
+            {"symtab-cache", no_argument,      nullptr, OPT_SYMTAB_CACHE},
+            {"load-wait",   no_argument,       nullptr, OPT_LOAD_WAIT},
+            {"vm-start",    required_argument, nullptr, OPT_VM_START},
+            {"help",        no_argument,       nullptr, OPT_HELP},
+            {nullptr, 0,                       nullptr, 0},
+    };
+    // a fresh dump every iteration unless asked otherwise
+    options.config.incremental = false;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", kOptions, nullptr)) != -1) {
+        uint64_t value = 0;
+        auto ok = true;
+        switch (opt) {
+            case OPT_OUT:
+                options.out_dir = optarg;
+                break;
+            case OPT_LIB:
+                options.library = optarg;
+                break;
+            case OPT_IMAGES:
+                ok = parse_uint(optarg, UINT32_MAX, value) && value > 0;
+                options.spec.images = (uint32_t) value;
+                break;
+            case OPT_CLASSES:
+                ok = parse_uint(optarg, UINT32_MAX, value);
+                options.spec.classes = (uint32_t) value;
+                break;
+            case OPT_FIELDS:
+                ok = parse_uint(optarg, UINT32_MAX, value);
+                options.spec.fields_per_class = (uint32_t) value;
+                break;
+            case OPT_METHODS:
+                ok = parse_uint(optarg, UINT32_MAX, value);
+                options.spec.methods_per_class = (uint32_t) value;
+                break;
+            case OPT_PARAMS:
+                ok = parse_uint(optarg, UINT32_MAX, value);
+                options.spec.params_per_method = (uint32_t) value;
+                break;
+            case OPT_PROPERTIES:
+                ok = parse_uint(optarg, UINT32_MAX, value);
+                options.spec.properties_per_class = (uint32_t) value;
+                break;
+            case OPT_SEED:
+                ok = parse_uint(optarg, UINT64_MAX, value);
+                options.spec.seed = value;
+                break;
+            case OPT_ITERATIONS:
+                ok = parse_uint(optarg, INT32_MAX, value) && value > 0;
+                options.iterations = (int) value;
+                break;
+            case OPT_WORKERS:
+                ok = parse_uint(optarg, 1024, value);
+                options.config.worker_count = (int) value;
+                break;
+            case OPT_FORMAT:
+                if (strcmp(optarg, "text") == 0) {
+                    options.config.format = DumpFormat::Text;
+                } else if (strcmp(optarg, "bin") == 0) {
+                    options.config.format = DumpFormat::Binary;
+                } else {
+                    ok = false;
+                }
+                break;
+            case OPT_GZIP:
+                ok = parse_uint(optarg, 9, value);
+                options.config.gzip_level = (int) value;
+                break;
+            case OPT_INCREMENTAL:
+                options.config.incremental = true;
+                break;
+            case OPT_NO_STATS:
+                options.config.stats = false;
+                break;
+            case OPT_FILTER:
+                ok = read_filter(optarg, options.config.filter);
+                break;
+            case OPT_SYMTAB:
+                options.symtab = true;
+                break;
+            case OPT_ADDR:
+                options.addr = true;
+                break;
+            case OPT_OPEN:
+                options.open = true;
+                break;
+            case OPT_SYMBOLS:
+                options.symbols = true;
+                break;
+            case OPT_STRESS:
+                ok = parse_uint(optarg, 1024, value) && value > 0;
+                options.stress_threads = (int) value;
+                break;
+            case OPT_SYMTAB_CACHE:
+                options.symtab_cache = true;
+                break;
+            case OPT_LOAD_WAIT:
+                options.load_wait = true;
+                break;
+            case OPT_VM_START:
+                if (strcmp(optarg, "poll") == 0) {
+                    options.vm_start = 1;
+                } else if (strcmp(optarg, "hook") == 0) {
+                    options.vm_start = 2;
+                } else {
+                    ok = false;
+                }
+                break;
+            default:
+                return false;
+        }
+        if (!ok) {
+            fprintf(stderr, "invalid value for --%s: %s\n", kOptions[opt - 1].name, optarg);
+            return false;
+        }
+    }
+    return optind == argc;
+}
+
+static uint64_t resident_bytes() {
+    auto fp = fopen("/proc/self/statm", "re");
+    if (!fp) {
+        return 0;
+    }
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    if (fscanf(fp, "%" SCNu64 " %" SCNu64, &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(fp);
+    return resident * (uint64_t) sysconf(_SC_PAGESIZE);
+}
+
+static uint64_t peak_resident_bytes() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t) usage.ru_maxrss * 1024;
+}
+
+// a copy of `from` at `to`, so loading it is a fresh load even if `from` cannot be unloaded
+static bool copy_file(const char *from, const char *to) {
+    auto in = fopen(from, "rbe");
+    auto out = fopen(to, "wbe");
+    auto ok = in && out;
+    char buffer[65536];
+    size_t n;
+    while (ok && (n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        ok = fwrite(buffer, 1, n, out) == n;
+    }
+    if (in) {
+        fclose(in);
+    }
+    if (out) {
+        ok = fclose(out) == 0 && ok;
+    }
+    return ok;
+}
+
+// one load of `path` seen by load_watcher_wait() from another thread, the time from dlopen()
+// returning to the waiter having the handle, or 0 when it was not seen. `reported_ns` gets the
+// latency load_watcher_wait() itself measured
+static uint64_t time_load_wait(const char *path, bool notify, uint64_t &reported_ns) {
+    uint64_t found_ns = 0;
+    std::thread waiter([path, &found_ns, &reported_ns] {
+        if (auto handle = load_watcher_wait(strrchr(path, '/') + 1, 5000, reported_ns)) {
+            found_ns = monotonic_ns();
+            xdl_close(handle);
+        }
+    });
+    // let the waiter find nothing and go to sleep first
+    usleep(20000);
+    auto library = dlopen(path, RTLD_NOW);
+    auto loaded_ns = monotonic_ns();
+    if (notify) {
+        // what the dlopen hooks do, followed by another load landing while the waiter looks, which
+        // the latency must not be taken from
+        load_watcher_notify(library);
+        load_watcher_notify(library);
+    }
+    waiter.join();
+    return library && found_ns ? found_ns - loaded_ns : 0;
+}
+
+static int run_load_wait_bench(const char *path, int rounds) {
+    char dir[] = "/tmp/load-wait-XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "mkdtemp failed: %s\n", strerror(errno));
+        return 1;
+    }
+    std::vector<uint64_t> polled;
+    std::vector<uint64_t> woken;
+    auto ok = true;
+    for (int round = 0; ok && round < rounds * 2; ++round) {
+        // polling first, the hooks cannot be taken back
+        auto hooked = round >= rounds;
+        if (round == rounds) {
+            load_watcher_set_hooked();
+        }
+        auto copy = std::string(dir) + "/libload" + std::to_string(round) + ".so";
+        ok = copy_file(path, copy.c_str());
+        uint64_t reported_ns = 0;
+        auto ns = ok ? time_load_wait(copy.c_str(), hooked, reported_ns) : 0;
+        if (!ns) {
+            fprintf(stderr, "%s was not loaded or not seen\n", copy.c_str());
+            ok = false;
+        } else if (hooked && (!reported_ns || reported_ns > ns)) {
+            fprintf(stderr, "%s: load_watcher_wait() reported %.3f ms, seen after %.3f ms\n", copy.c_str(),
+                    (double) reported_ns / 1e6, (double) ns / 1e6);
+            ok = false;
+        } else {
+            (hooked ? woken : polled).push_back(ns);
+        }
+        unlink(copy.c_str());
+    }
+    rmdir(dir);
+    if (!ok) {
+        return 1;
+    }
+    for (auto times: {&polled, &woken}) {
+        std::sort(times->begin(), times->end());
+        printf("%s: %zu loads, median %.3f ms, worst %.3f ms after dlopen\n",
+               times == &polled ? "polled" : "woken by hook", times->size(),
+               (double) (*times)[times->size() / 2] / 1e6, (double) times->back() / 1e6);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    mkdir(options.out_dir.c_str(), 0755);
+    mkdir((options.out_dir + "/files").c_str(), 0755);
+
+    if (options.symtab_cache) {
+#ifdef FAKE_MINIDEBUG_PATH
+        // xdl only force-loads its liblzma.so on Android
+        if (!dlopen(XDL_LZMA_PATHNAME, RTLD_NOW)) {
+            fprintf(stderr, "dlopen %s failed: %s\n", XDL_LZMA_PATHNAME, dlerror());
+            return 1;
+        }
+        return run_symtab_cache_bench(FAKE_MINIDEBUG_PATH, FAKE_MINIDEBUG_PATH ".debug");
+#else
+        fprintf(stderr, "built without xz or liblzma, there is no library with .gnu_debugdata\n");
+        return 1;
+#endif
+    }
+    if (options.load_wait) {
+        return run_load_wait_bench(options.library.c_str(), options.iterations);
+    }
+    auto library = dlopen(options.library.c_str(), RTLD_NOW);
+    if (!library) {
+        fprintf(stderr, "dlopen %s failed: %s\n", options.library.c_str(), dlerror());
+        return 1;
+    }
+    if (options.symtab) {
+        return run_symtab_bench("libil2cpp.so");
+    }
+    if (options.addr) {
+        return run_addr_bench("libil2cpp.so");
+    }
+    if (options.open) {
+        return run_open_bench("libil2cpp.so");
+    }
+    if (options.symbols) {
+        return run_symbols_bench();
+    }
+    if (options.stress_threads > 0) {
+        return run_stress_bench("libil2cpp.so", options.stress_threads, options.iterations);
+    }
+    auto generate = reinterpret_cast<decltype(&fake_il2cpp_generate)>(dlsym(library, "fake_il2cpp_generate"));
+    if (!generate) {
+        fprintf(stderr, "%s is not a fake libil2cpp.so\n", options.library.c_str());
+        return 1;
+    }
+    auto begin = monotonic_ns();
+    generate(&options.spec);
+    auto generate_ns = monotonic_ns() - begin;
+    auto model_rss = resident_bytes();
+    printf("model: %u images, %u classes, generated in %.1f ms, rss %.1f MB\n", options.spec.images,
+           options.spec.classes, (double) generate_ns / 1e6, (double) model_rss / 1048576.0);
+
+    // the same lookup the module does on a device
+    auto handle = xdl_open("libil2cpp.so", XDL_DEFAULT);
+    if (!handle) {
+        fprintf(stderr, "xdl_open libil2cpp.so failed\n");
+        return 1;
+    }
+    if (options.vm_start) {
+        auto stop_vm = reinterpret_cast<decltype(&fake_il2cpp_stop_vm)>(dlsym(library, "fake_il2cpp_stop_vm"));
+        auto init = reinterpret_cast<int (*)(const char *)>(dlsym(library, "il2cpp_init"));
+        stop_vm();
+        auto hooked = options.vm_start == 2;
+        if (hooked) {
+            il2cpp_vm_ready_hooked();
+        }
+        uint64_t started_ns = 0;
+        std::thread game([init, hooked, &started_ns] {
+            // let il2cpp_api_init() find the VM stopped and go to sleep first
+            usleep(50000);
+            init("IL2CPP Root Domain");
+            started_ns = monotonic_ns();
+            if (hooked) {
+                // what the il2cpp_init hook does
+                il2cpp_vm_ready();
+            }
+        });
+        il2cpp_api_init(handle, options.out_dir.c_str());
+        auto seen_ns = monotonic_ns();
+        game.join();
+        printf("il2cpp_init %s %.3f ms after it returned\n", hooked ? "reported by hook" : "polled",
+               (double) (seen_ns - started_ns) / 1e6);
+    } else {
+        il2cpp_api_init(handle, options.out_dir.c_str());
+    }
+
+    std::vector<uint64_t> times;
+    for (int i = 0; i < options.iterations; ++i) {
+        begin = monotonic_ns();
+        il2cpp_dump(options.out_dir.c_str(), options.config);
+        times.push_back(monotonic_ns() - begin);
+        printf("dump %d: %.3f ms\n", i + 1, (double) times.back() / 1e6);
+    }
+    xdl_close(handle);
+
+    uint64_t total = 0;
+    auto best = times[0];
+    for (auto time: times) {
+        total += time;
+        best = std::min(best, time);
+    }
+    auto mean = (double) total / (double) times.size();
+    auto classes = (double) std::max<uint32_t>(options.spec.classes, 1);
+    auto peak_rss = peak_resident_bytes();
+    printf("%d dumps: mean %.3f ms, best %.3f ms, %.2f dumps/s, %.1f ns/class\n", options.iterations, mean / 1e6,
+           (double) best / 1e6, 1e9 / mean, mean / classes);
+    printf("peak rss %.1f MB, %.1f MB above the model\n", (double) peak_rss / 1048576.0,
+           (double) (peak_rss - std::min(peak_rss, model_rss)) / 1048576.0);
+    return 0;
+}
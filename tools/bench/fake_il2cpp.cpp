@@ -0,0 +1,640 @@
+// Synthetic libil2cpp.so for benchmarking the dump engine on the host. It exports the
+// il2cpp_* functions il2cpp_dump() uses, backed by a model generated from a FakeIl2CppSpec,
+// with method pointers inside the library so RVAs look like the real thing.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+#include <string_view>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <dlfcn.h>
+#include "il2cpp-tabledefs.h"
+#include "il2cpp-class.h"
+#include "fake_il2cpp.h"
+
+struct FieldInfo {
+    const char *name;
+    const Il2CppType *type;
+    int flags;
+    size_t offset;
+    uint64_t value;
+};
+
+struct PropertyInfo {
+    const char *name;
+    const MethodInfo *get;
+    const MethodInfo *set;
+};
+
+struct FakeMethod {
+    MethodInfo info;
+    const char *name;
+    uint32_t flags;
+    const Il2CppType *return_type;
+    uint32_t param_begin;
+    uint32_t param_count;
+};
+
+struct FakeParam {
+    const Il2CppType *type;
+    const char *name;
+};
+
+struct Il2CppClass {
+    const Il2CppImage *image;
+    const char *name;
+    const char *namespaze;
+    Il2CppType byval_arg;
+    int flags;
+    uint32_t token;
+    bool valuetype;
+    bool enumtype;
+    Il2CppClass *parent;
+    Il2CppClass *declaring;
+    std::vector<Il2CppClass *> interfaces;
+    std::vector<FieldInfo> fields;
+    std::vector<PropertyInfo> properties;
+    std::vector<FakeMethod> methods;
+};
+
+struct Il2CppImage {
+    const char *name;
+    std::vector<Il2CppClass *> classes;
+};
+
+struct Il2CppAssembly {
+    Il2CppImage *image;
+};
+
+struct Il2CppDomain {
+    int dummy;
+};
+
+struct Il2CppThread {
+    int dummy;
+};
+
+namespace {
+
+struct Model {
+    std::deque<std::string> strings;
+    // like global-metadata, every distinct name is stored once
+    std::unordered_map<std::string_view, const char *> string_index;
+    std::deque<Il2CppImage> images;
+    std::deque<Il2CppAssembly> assemblies;
+    std::vector<const Il2CppAssembly *> assembly_list;
+    std::deque<Il2CppClass> classes;
+    std::vector<FakeParam> params;
+    std::vector<Il2CppClass *> type_pool;
+    std::vector<Il2CppClass *> interface_pool;
+    // like il2cpp metadata, identical types share one Il2CppType
+    std::map<std::tuple<Il2CppClass *, bool, uint32_t>, Il2CppType *> types;
+    std::deque<Il2CppType> type_storage;
+    Il2CppClass *object_class = nullptr;
+    Il2CppDomain domain{};
+};
+
+Model *g_model = nullptr;
+thread_local Il2CppThread g_thread{};
+std::atomic<bool> g_vm_started{true};
+
+uint64_t g_rng = 0x9E3779B97F4A7C15ull;
+
+uint64_t next_rand() {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+uint32_t rand_below(uint32_t n) {
+    return n ? (uint32_t) (next_rand() % n) : 0;
+}
+
+const char *intern(Model &m, std::string s) {
+    auto it = m.string_index.find(s);
+    if (it != m.string_index.end()) {
+        return it->second;
+    }
+    auto &stored = m.strings.emplace_back(std::move(s));
+    m.string_index.emplace(stored, stored.c_str());
+    return stored.c_str();
+}
+
+uintptr_t code_base() {
+    Dl_info info;
+    if (dladdr((void *) &code_base, &info)) {
+        return reinterpret_cast<uintptr_t>(info.dli_fbase);
+    }
+    return 0;
+}
+
+Il2CppClass *new_class(Model &m, Il2CppImage *image, const char *ns, const char *name, int flags,
+                       Il2CppTypeEnum type_enum) {
+    m.classes.emplace_back();
+    auto *klass = &m.classes.back();
+    klass->image = image;
+    klass->name = name;
+    klass->namespaze = ns;
+    klass->flags = flags;
+    klass->token = 0x02000000u | (uint32_t) (image->classes.size() + 1);
+    klass->byval_arg = {};
+    klass->byval_arg.data.dummy = klass;
+    klass->byval_arg.type = type_enum;
+    klass->parent = nullptr;
+    klass->declaring = nullptr;
+    klass->valuetype = false;
+    klass->enumtype = false;
+    image->classes.push_back(klass);
+    return klass;
+}
+
+const Il2CppType *make_type(Model &m, Il2CppClass *klass, bool byref, uint32_t attrs) {
+    if (!byref && !attrs) {
+        return &klass->byval_arg;
+    }
+    auto &type = m.types[std::make_tuple(klass, byref, attrs)];
+    if (!type) {
+        m.type_storage.emplace_back();
+        type = &m.type_storage.back();
+        type->data.dummy = klass;
+        type->type = klass->byval_arg.type;
+        type->byref = byref ? 1 : 0;
+        type->attrs = attrs;
+    }
+    return type;
+}
+
+void build_corlib(Model &m, Il2CppImage *corlib) {
+    static const struct {
+        const char *name;
+        Il2CppTypeEnum type;
+        bool valuetype;
+    } core[] = {
+            {"Object",  IL2CPP_TYPE_OBJECT,    false},
+            {"Void",    IL2CPP_TYPE_VOID,      true},
+            {"Boolean", IL2CPP_TYPE_BOOLEAN,   true},
+            {"Int32",   IL2CPP_TYPE_I4,        true},
+            {"Int64",   IL2CPP_TYPE_I8,        true},
+            {"Single",  IL2CPP_TYPE_R4,        true},
+            {"String",  IL2CPP_TYPE_STRING,    false},
+            {"Type",    IL2CPP_TYPE_CLASS,     false},
+    };
+    for (auto &c: core) {
+        auto flags = TYPE_ATTRIBUTE_PUBLIC | TYPE_ATTRIBUTE_SERIALIZABLE;
+        if (c.valuetype) {
+            flags |= TYPE_ATTRIBUTE_SEALED;
+        }
+        auto *klass = new_class(m, corlib, "System", c.name, flags, c.type);
+        klass->valuetype = c.valuetype;
+        m.type_pool.push_back(klass);
+        if (!m.object_class) {
+            m.object_class = klass;
+        } else {
+            klass->parent = m.object_class;
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        auto *itf = new_class(m, corlib, "System.Collections",
+                              intern(m, "IInterface" + std::to_string(i)),
+                              TYPE_ATTRIBUTE_PUBLIC | TYPE_ATTRIBUTE_INTERFACE |
+                              TYPE_ATTRIBUTE_ABSTRACT, IL2CPP_TYPE_CLASS);
+        m.interface_pool.push_back(itf);
+    }
+}
+
+void build_members(Model &m, Il2CppClass *klass, const FakeIl2CppSpec &spec, uintptr_t base) {
+    auto pick_type = [&m]() {
+        return m.type_pool[rand_below((uint32_t) m.type_pool.size())];
+    };
+    if (klass->enumtype) {
+        FieldInfo value{};
+        value.name = "value__";
+        value.type = make_type(m, m.type_pool[3], false, 0);
+        value.flags = FIELD_ATTRIBUTE_PUBLIC | FIELD_ATTRIBUTE_RT_SPECIAL_NAME | FIELD_ATTRIBUTE_SPECIAL_NAME;
+        value.offset = 0x10;
+        klass->fields.push_back(value);
+        for (uint32_t i = 0; i < spec.fields_per_class; ++i) {
+            FieldInfo field{};
+            field.name = intern(m, "Value" + std::to_string(i));
+            field.type = make_type(m, klass, false, 0);
+            field.flags = FIELD_ATTRIBUTE_PUBLIC | FIELD_ATTRIBUTE_STATIC | FIELD_ATTRIBUTE_LITERAL;
+            field.offset = 0;
+            field.value = i * (uint64_t) (1 + rand_below(3));
+            klass->fields.push_back(field);
+        }
+        return;
+    }
+    size_t offset = klass->valuetype ? 0x10 : 0x18;
+    for (uint32_t i = 0; i < spec.fields_per_class; ++i) {
+        FieldInfo field{};
+        field.name = intern(m, "field_" + std::to_string(i));
+        field.type = make_type(m, pick_type(), false, 0);
+        field.flags = (int) (1 + rand_below(6));
+        auto r = rand_below(8);
+        if (r == 0) {
+            field.flags |= FIELD_ATTRIBUTE_STATIC;
+        } else if (r == 1) {
+            field.flags |= FIELD_ATTRIBUTE_INIT_ONLY;
+        } else if (r == 2) {
+            field.flags |= FIELD_ATTRIBUTE_STATIC | FIELD_ATTRIBUTE_INIT_ONLY;
+        } else if (r == 3) {
+            field.flags |= FIELD_ATTRIBUTE_STATIC | FIELD_ATTRIBUTE_LITERAL;
+        }
+        field.offset = offset;
+        offset += 4 + 4 * rand_below(2);
+        klass->fields.push_back(field);
+    }
+    for (uint32_t i = 0; i < spec.methods_per_class; ++i) {
+        FakeMethod method{};
+        method.name = i == 0 ? ".ctor" : intern(m, "Method_" + std::to_string(i));
+        method.flags = 1 + rand_below(6);
+        auto r = rand_below(10);
+        if (r == 0) {
+            method.flags |= METHOD_ATTRIBUTE_STATIC;
+        } else if (r == 1) {
+            method.flags |= METHOD_ATTRIBUTE_VIRTUAL | METHOD_ATTRIBUTE_NEW_SLOT;
+        } else if (r == 2) {
+            method.flags |= METHOD_ATTRIBUTE_VIRTUAL;
+        } else if (r == 3) {
+            method.flags |= METHOD_ATTRIBUTE_VIRTUAL | METHOD_ATTRIBUTE_FINAL;
+        } else if (r == 4 && klass->flags & TYPE_ATTRIBUTE_ABSTRACT) {
+            method.flags |= METHOD_ATTRIBUTE_VIRTUAL | METHOD_ATTRIBUTE_ABSTRACT | METHOD_ATTRIBUTE_NEW_SLOT;
+        } else if (r == 5) {
+            method.flags |= METHOD_ATTRIBUTE_STATIC | METHOD_ATTRIBUTE_PINVOKE_IMPL;
+        }
+        if (!(method.flags & METHOD_ATTRIBUTE_ABSTRACT)) {
+            method.info.methodPointer = (Il2CppMethodPointer) (base + 0x100000 + next_rand() % 0x4000000);
+        }
+        method.return_type = make_type(m, pick_type(), rand_below(20) == 0, 0);
+        method.param_begin = (uint32_t) m.params.size();
+        method.param_count = rand_below(spec.params_per_method + 1);
+        for (uint32_t p = 0; p < method.param_count; ++p) {
+            FakeParam param{};
+            auto byref = rand_below(6) == 0;
+            uint32_t attrs = 0;
+            auto a = rand_below(4);
+            if (a == 1) {
+                attrs = PARAM_ATTRIBUTE_IN;
+            } else if (a == 2) {
+                attrs = PARAM_ATTRIBUTE_OUT;
+            } else if (a == 3) {
+                attrs = PARAM_ATTRIBUTE_IN | PARAM_ATTRIBUTE_OUT;
+            }
+            param.type = make_type(m, pick_type(), byref, attrs);
+            param.name = intern(m, "arg" + std::to_string(p));
+            m.params.push_back(param);
+        }
+        klass->methods.push_back(method);
+    }
+    for (uint32_t i = 0; i < spec.properties_per_class && i + 1 < klass->methods.size(); ++i) {
+        PropertyInfo prop{};
+        prop.name = intern(m, "Property" + std::to_string(i));
+        auto r = rand_below(3);
+        if (r != 1) {
+            prop.get = &klass->methods[i + 1].info;
+        }
+        auto &setter = klass->methods[klass->methods.size() - 1 - i];
+        if (r != 0 && setter.param_count > 0) {
+            prop.set = &setter.info;
+        } else if (!prop.get) {
+            prop.get = &klass->methods[i + 1].info;
+        }
+        klass->properties.push_back(prop);
+    }
+}
+
+}
+
+extern "C" {
+
+__attribute__((visibility("default")))
+void fake_il2cpp_generate(const FakeIl2CppSpec *spec) {
+    delete g_model;
+    g_model = new Model();
+    auto &m = *g_model;
+    g_rng = spec->seed ? spec->seed : 0x9E3779B97F4A7C15ull;
+    auto base = code_base();
+
+    auto add_image = [&m](const char *name) {
+        m.images.emplace_back();
+        auto *image = &m.images.back();
+        image->name = name;
+        m.assemblies.push_back(Il2CppAssembly{image});
+        m.assembly_list.push_back(&m.assemblies.back());
+        return image;
+    };
+    auto *corlib = add_image("mscorlib.dll");
+    build_corlib(m, corlib);
+    std::vector<Il2CppImage *> images{corlib};
+    for (uint32_t i = 1; i < spec->images; ++i) {
+        std::string name;
+        if (i == 1) {
+            name = "Assembly-CSharp.dll";
+        } else if (i % 3 == 0) {
+            name = "UnityEngine.Module" + std::to_string(i) + ".dll";
+        } else if (i % 3 == 1) {
+            name = "System.Library" + std::to_string(i) + ".dll";
+        } else {
+            name = "Game.Library" + std::to_string(i) + ".dll";
+        }
+        images.push_back(add_image(intern(m, name)));
+    }
+
+    std::vector<Il2CppClass *> generated;
+    for (uint32_t i = 0; i < spec->classes; ++i) {
+        auto *image = images[i % images.size()];
+        auto ns = intern(m, i % 5 == 0 ? std::string() : "Game.Namespace" + std::to_string(i % 17));
+        auto name = intern(m, "Class" + std::to_string(i));
+        int flags;
+        auto kind = rand_below(12);
+        Il2CppTypeEnum type_enum = IL2CPP_TYPE_CLASS;
+        if (kind == 0) {
+            flags = TYPE_ATTRIBUTE_PUBLIC | TYPE_ATTRIBUTE_SEALED;
+            type_enum = IL2CPP_TYPE_VALUETYPE;
+        } else if (kind == 1) {
+            flags = TYPE_ATTRIBUTE_PUBLIC | TYPE_ATTRIBUTE_SEALED | TYPE_ATTRIBUTE_SERIALIZABLE;
+            type_enum = IL2CPP_TYPE_VALUETYPE;
+        } else if (kind == 2) {
+            flags = TYPE_ATTRIBUTE_PUBLIC | TYPE_ATTRIBUTE_INTERFACE | TYPE_ATTRIBUTE_ABSTRACT;
+        } else if (kind == 3) {
+            flags = TYPE_ATTRIBUTE_PUBLIC | TYPE_ATTRIBUTE_ABSTRACT | TYPE_ATTRIBUTE_SEALED;
+        } else if (kind == 4) {
+            flags = TYPE_ATTRIBUTE_NOT_PUBLIC | TYPE_ATTRIBUTE_ABSTRACT;
+        } else {
+            flags = (int) (1 + rand_below(7));
+            if (rand_below(3) == 0) {
+                flags |= TYPE_ATTRIBUTE_SEALED;
+            }
+            if (rand_below(4) == 0) {
+                flags |= TYPE_ATTRIBUTE_SERIALIZABLE;
+            }
+        }
+        auto *klass = new_class(m, image, ns, name, flags, type_enum);
+        if (kind == 0) {
+            klass->enumtype = true;
+            klass->valuetype = true;
+        } else if (kind == 1) {
+            klass->valuetype = true;
+        }
+        if (kind != 2) {
+            if (!generated.empty() && rand_below(3) == 0) {
+                klass->parent = generated[rand_below((uint32_t) generated.size())];
+            } else {
+                klass->parent = m.object_class;
+            }
+        }
+        auto itf_count = rand_below(3);
+        for (uint32_t j = 0; j < itf_count; ++j) {
+            klass->interfaces.push_back(m.interface_pool[rand_below((uint32_t) m.interface_pool.size())]);
+        }
+        // nested types report an empty namespace, like in il2cpp
+        if (i % 10 == 0 && !generated.empty()) {
+            klass->declaring = generated.back();
+        }
+        generated.push_back(klass);
+        if (m.type_pool.size() < 512 && rand_below(4) == 0) {
+            m.type_pool.push_back(klass);
+        }
+    }
+    for (auto &klass: m.classes) {
+        build_members(m, &klass, *spec, base);
+    }
+}
+
+__attribute__((visibility("default")))
+Il2CppDomain *il2cpp_domain_get() {
+    return &g_model->domain;
+}
+
+__attribute__((visibility("default")))
+const Il2CppAssembly **il2cpp_domain_get_assemblies(const Il2CppDomain *, size_t *size) {
+    *size = g_model->assembly_list.size();
+    return g_model->assembly_list.data();
+}
+
+__attribute__((visibility("default")))
+const Il2CppImage *il2cpp_assembly_get_image(const Il2CppAssembly *assembly) {
+    return assembly->image;
+}
+
+__attribute__((visibility("default")))
+const char *il2cpp_image_get_name(const Il2CppImage *image) {
+    return image->name;
+}
+
+__attribute__((visibility("default")))
+size_t il2cpp_image_get_class_count(const Il2CppImage *image) {
+    return image->classes.size();
+}
+
+__attribute__((visibility("default")))
+const Il2CppClass *il2cpp_image_get_class(const Il2CppImage *image, size_t index) {
+    return image->classes[index];
+}
+
+__attribute__((visibility("default")))
+const Il2CppType *il2cpp_class_get_type(Il2CppClass *klass) {
+    return &klass->byval_arg;
+}
+
+__attribute__((visibility("default")))
+Il2CppClass *il2cpp_class_from_type(const Il2CppType *type) {
+    return (Il2CppClass *) type->data.dummy;
+}
+
+__attribute__((visibility("default")))
+const char *il2cpp_class_get_name(Il2CppClass *klass) {
+    return klass->name;
+}
+
+__attribute__((visibility("default")))
+Il2CppClass *il2cpp_class_get_declaring_type(Il2CppClass *klass) {
+    return klass->declaring;
+}
+
+__attribute__((visibility("default")))
+const char *il2cpp_class_get_namespace(Il2CppClass *klass) {
+    return klass->namespaze;
+}
+
+__attribute__((visibility("default")))
+int il2cpp_class_get_flags(const Il2CppClass *klass) {
+    return klass->flags;
+}
+
+__attribute__((visibility("default")))
+uint32_t il2cpp_class_get_type_token(Il2CppClass *klass) {
+    return klass->token;
+}
+
+__attribute__((visibility("default")))
+bool il2cpp_class_is_valuetype(const Il2CppClass *klass) {
+    return klass->valuetype;
+}
+
+__attribute__((visibility("default")))
+bool il2cpp_class_is_enum(const Il2CppClass *klass) {
+    return klass->enumtype;
+}
+
+__attribute__((visibility("default")))
+Il2CppClass *il2cpp_class_get_parent(Il2CppClass *klass) {
+    return klass->parent;
+}
+
+__attribute__((visibility("default")))
+Il2CppClass *il2cpp_class_get_interfaces(Il2CppClass *klass, void **iter) {
+    auto index = reinterpret_cast<uintptr_t>(*iter);
+    if (index >= klass->interfaces.size()) {
+        return nullptr;
+    }
+    *iter = reinterpret_cast<void *>(index + 1);
+    return klass->interfaces[index];
+}
+
+__attribute__((visibility("default")))
+FieldInfo *il2cpp_class_get_fields(Il2CppClass *klass, void **iter) {
+    auto index = reinterpret_cast<uintptr_t>(*iter);
+    if (index >= klass->fields.size()) {
+        return nullptr;
+    }
+    *iter = reinterpret_cast<void *>(index + 1);
+    return &klass->fields[index];
+}
+
+__attribute__((visibility("default")))
+const PropertyInfo *il2cpp_class_get_properties(Il2CppClass *klass, void **iter) {
+    auto index = reinterpret_cast<uintptr_t>(*iter);
+    if (index >= klass->properties.size()) {
+        return nullptr;
+    }
+    *iter = reinterpret_cast<void *>(index + 1);
+    return &klass->properties[index];
+}
+
+__attribute__((visibility("default")))
+const MethodInfo *il2cpp_class_get_methods(Il2CppClass *klass, void **iter) {
+    auto index = reinterpret_cast<uintptr_t>(*iter);
+    if (index >= klass->methods.size()) {
+        return nullptr;
+    }
+    *iter = reinterpret_cast<void *>(index + 1);
+    return &klass->methods[index].info;
+}
+
+__attribute__((visibility("default")))
+int il2cpp_field_get_flags(FieldInfo *field) {
+    return field->flags;
+}
+
+__attribute__((visibility("default")))
+const char *il2cpp_field_get_name(FieldInfo *field) {
+    return field->name;
+}
+
+__attribute__((visibility("default")))
+size_t il2cpp_field_get_offset(FieldInfo *field) {
+    return field->offset;
+}
+
+__attribute__((visibility("default")))
+const Il2CppType *il2cpp_field_get_type(FieldInfo *field) {
+    return field->type;
+}
+
+__attribute__((visibility("default")))
+void il2cpp_field_static_get_value(FieldInfo *field, void *value) {
+    memcpy(value, &field->value, sizeof(field->value));
+}
+
+__attribute__((visibility("default")))
+const MethodInfo *il2cpp_property_get_get_method(PropertyInfo *prop) {
+    return prop->get;
+}
+
+__attribute__((visibility("default")))
+const MethodInfo *il2cpp_property_get_set_method(PropertyInfo *prop) {
+    return prop->set;
+}
+
+__attribute__((visibility("default")))
+const char *il2cpp_property_get_name(PropertyInfo *prop) {
+    return prop->name;
+}
+
+__attribute__((visibility("default")))
+uint32_t il2cpp_method_get_flags(const MethodInfo *method, uint32_t *iflags) {
+    if (iflags) {
+        *iflags = 0;
+    }
+    return reinterpret_cast<const FakeMethod *>(method)->flags;
+}
+
+__attribute__((visibility("default")))
+const Il2CppType *il2cpp_method_get_return_type(const MethodInfo *method) {
+    return reinterpret_cast<const FakeMethod *>(method)->return_type;
+}
+
+__attribute__((visibility("default")))
+const char *il2cpp_method_get_name(const MethodInfo *method) {
+    return reinterpret_cast<const FakeMethod *>(method)->name;
+}
+
+__attribute__((visibility("default")))
+uint32_t il2cpp_method_get_param_count(const MethodInfo *method) {
+    return reinterpret_cast<const FakeMethod *>(method)->param_count;
+}
+
+__attribute__((visibility("default")))
+const Il2CppType *il2cpp_method_get_param(const MethodInfo *method, uint32_t index) {
+    auto fake = reinterpret_cast<const FakeMethod *>(method);
+    if (index >= fake->param_count) {
+        return nullptr;
+    }
+    return g_model->params[fake->param_begin + index].type;
+}
+
+__attribute__((visibility("default")))
+const char *il2cpp_method_get_param_name(const MethodInfo *method, uint32_t index) {
+    auto fake = reinterpret_cast<const FakeMethod *>(method);
+    return g_model->params[fake->param_begin + index].name;
+}
+
+__attribute__((visibility("default")))
+bool il2cpp_type_is_byref(const Il2CppType *type) {
+    return type->byref;
+}
+
+__attribute__((visibility("default")))
+Il2CppThread *il2cpp_thread_attach(Il2CppDomain *) {
+    return &g_thread;
+}
+
+__attribute__((visibility("default")))
+void il2cpp_thread_detach(Il2CppThread *) {
+}
+
+__attribute__((visibility("default")))
+bool il2cpp_is_vm_thread(Il2CppThread *) {
+    return g_vm_started;
+}
+
+__attribute__((visibility("default")))
+int il2cpp_init(const char *) {
+    g_vm_started = true;
+    return 1;
+}
+
+__attribute__((visibility("default")))
+void fake_il2cpp_stop_vm() {
+    g_vm_started = false;
+}
+
+}
@@ -0,0 +1,25 @@
+#ifndef ZYGISK_IL2CPPDUMPER_FAKE_IL2CPP_H
+#define ZYGISK_IL2CPPDUMPER_FAKE_IL2CPP_H
+
+#include <cstdint>
+
+// shape of the generated metadata; images and classes are totals, the rest is per class
+// or, for params, the maximum per method
+struct FakeIl2CppSpec {
+    uint32_t images;
+    uint32_t classes;
+    uint32_t fields_per_class;
+    uint32_t methods_per_class;
+    uint32_t params_per_method;
+    uint32_t properties_per_class;
+    uint64_t seed;
+};
+
+// replaces the current model, call before il2cpp_api_init()
+extern "C" void fake_il2cpp_generate(const FakeIl2CppSpec *spec);
+
+// il2cpp_is_vm_thread() is false from here until il2cpp_init() is called, like in a game that
+// has not started its VM yet
+extern "C" void fake_il2cpp_stop_vm();
+
+#endif //ZYGISK_IL2CPPDUMPER_FAKE_IL2CPP_H
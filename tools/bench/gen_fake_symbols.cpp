@@ -0,0 +1,41 @@
+// Writes a C file with `count` hidden functions named like il2cpp internals, so the fake
+// libil2cpp.so carries a .symtab of realistic size for the xdl_dsym() benchmark. Every 16th one
+// also gets an alias, which xdl_addr() must not report in its place.
+//
+//   gen_fake_symbols <count> <out.c>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+static std::string length_prefixed(const std::string &name) {
+    return std::to_string(name.size()) + name;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <count> <out.c>\n", argv[0]);
+        return 2;
+    }
+    auto count = strtoul(argv[1], nullptr, 10);
+    auto out = fopen(argv[2], "we");
+    if (!out) {
+        perror(argv[2]);
+        return 1;
+    }
+    static const char *kNamespaces[] = {"vm", "os", "gc", "utils", "metadata", "icalls"};
+    fprintf(out, "// generated by gen_fake_symbols, do not edit\n\n");
+    for (unsigned long i = 0; i < count; ++i) {
+        auto name = "_ZN6il2cpp" + length_prefixed(kNamespaces[i % 6]) +
+                    length_prefixed("Type" + std::to_string(i / 16)) +
+                    length_prefixed("Method" + std::to_string(i % 16)) + "Ev";
+        fprintf(out, "__attribute__((visibility(\"hidden\"), used, noinline)) int %s(void) { return %lu; }\n",
+                name.c_str(), i);
+        // some share their code with an alias, like identical functions folded by the linker
+        if (i % 16 == 15) {
+            fprintf(out, "__attribute__((visibility(\"hidden\"), alias(\"%s\"))) int %s_alias(void);\n",
+                    name.c_str(), name.c_str());
+        }
+    }
+    return fclose(out) == 0 ? 0 : 1;
+}
@@ -0,0 +1,29 @@
+// Host stand-in for <android/api-level.h>, the host pretends to be API 33.
+
+#ifndef ZYGISK_IL2CPPDUMPER_HOST_ANDROID_API_LEVEL_H
+#define ZYGISK_IL2CPPDUMPER_HOST_ANDROID_API_LEVEL_H
+
+#define __ANDROID_API_J__ 16
+#define __ANDROID_API_L__ 21
+#define __ANDROID_API_L_MR1__ 22
+#define __ANDROID_API_M__ 23
+#define __ANDROID_API_N__ 24
+#define __ANDROID_API_N_MR1__ 25
+#define __ANDROID_API_O__ 26
+#define __ANDROID_API_O_MR1__ 27
+#define __ANDROID_API_P__ 28
+#define __ANDROID_API_Q__ 29
+#define __ANDROID_API_R__ 30
+#define __ANDROID_API__ 33
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int android_get_device_api_level(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZYGISK_IL2CPPDUMPER_HOST_ANDROID_API_LEVEL_H
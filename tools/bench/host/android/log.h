@@ -0,0 +1,23 @@
+// Host stand-in for <android/log.h>, implemented in android_shim.c.
+
+#ifndef ZYGISK_IL2CPPDUMPER_HOST_ANDROID_LOG_H
+#define ZYGISK_IL2CPPDUMPER_HOST_ANDROID_LOG_H
+
+enum {
+  ANDROID_LOG_DEBUG = 3,
+  ANDROID_LOG_INFO = 4,
+  ANDROID_LOG_WARN = 5,
+  ANDROID_LOG_ERROR = 6,
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZYGISK_IL2CPPDUMPER_HOST_ANDROID_LOG_H
@@ -0,0 +1,31 @@
+// Host implementations of the few bionic/liblog functions the module calls.
+// DUMP_BENCH_LOG=D|I|W|E sets the lowest priority printed to stderr, E by default.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <android/api-level.h>
+#include <android/log.h>
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...) {
+  static int min_prio = -1;
+  if (min_prio < 0) {
+    static const char kLevels[] = "DIWE";
+    const char *env = getenv("DUMP_BENCH_LOG");
+    const char *level = env && *env ? strchr(kLevels, *env) : NULL;
+    min_prio = level ? ANDROID_LOG_DEBUG + (int)(level - kLevels) : ANDROID_LOG_ERROR;
+  }
+  if (prio < min_prio) return 0;
+  va_list ap;
+  va_start(ap, fmt);
+  fprintf(stderr, "%s: ", tag);
+  int r = vfprintf(stderr, fmt, ap);
+  fputc('\n', stderr);
+  va_end(ap);
+  return r;
+}
+
+int android_get_device_api_level(void) {
+  return __ANDROID_API__;
+}
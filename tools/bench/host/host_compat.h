@@ -0,0 +1,34 @@
+// Force-included into the xdl sources so they build against glibc instead of bionic.
+
+#ifndef ZYGISK_IL2CPPDUMPER_HOST_COMPAT_H
+#define ZYGISK_IL2CPPDUMPER_HOST_COMPAT_H
+
+#include <string.h>
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+static inline size_t xdl_host_strlcpy(char *dst, const char *src, size_t size) {
+  size_t len = strlen(src);
+  if (size) {
+    size_t n = len >= size ? size - 1 : len;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#define strlcpy xdl_host_strlcpy
+#endif
+
+#include <android/api-level.h>
+#include <elf.h>
+#include <link.h>
+
+// glibc's ld.so relocates the dynamic section in place, except the vDSO's
+#define XDL_DYNAMIC_PTR(load_bias, d_ptr) \
+  ((uintptr_t)(d_ptr) < (uintptr_t)(load_bias) ? (uintptr_t)(load_bias) + (uintptr_t)(d_ptr) : (uintptr_t)(d_ptr))
+
+#ifndef ELF_ST_TYPE
+#define ELF_ST_TYPE(x) ELF64_ST_TYPE(x)
+#define ELF_ST_BIND(x) ELF64_ST_BIND(x)
+#endif
+
+#endif //ZYGISK_IL2CPPDUMPER_HOST_COMPAT_H
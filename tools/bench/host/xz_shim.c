@@ -0,0 +1,91 @@
+// The XzUnpacker functions xdl takes from Android's liblzma.so (the LZMA SDK), implemented with
+// the host's xz-utils, so .gnu_debugdata can be decompressed off device. Only what
+// xdl_lzma_decompress() uses, with the Android 10+ signature of XzUnpacker_Code.
+
+#include <lzma.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+enum { SZ_OK = 0, SZ_ERROR_DATA = 1 };
+enum {
+  CODER_STATUS_NOT_SPECIFIED,
+  CODER_STATUS_FINISHED_WITH_MARK,
+  CODER_STATUS_NOT_FINISHED,
+  CODER_STATUS_NEEDS_MORE_INPUT
+};
+
+// lives in the caller's state buffer, which stays readable after XzUnpacker_Free()
+typedef struct {
+  lzma_stream *stream;
+  bool finished;
+  bool end_pending;  // liblzma reached the end, XzUnpacker_Code() has yet to report it
+} xz_shim_state_t;
+
+void CrcGenerateTable(void) {}
+
+void Crc64GenerateTable(void) {}
+
+void XzUnpacker_Construct(void *p, const void *alloc) {
+  (void)alloc;
+  xz_shim_state_t *state = (xz_shim_state_t *)p;
+  state->finished = false;
+  state->end_pending = false;
+  state->stream = calloc(1, sizeof(lzma_stream));
+  if (NULL != state->stream && LZMA_OK != lzma_stream_decoder(state->stream, UINT64_MAX, 0)) {
+    free(state->stream);
+    state->stream = NULL;
+  }
+}
+
+int XzUnpacker_Code(void *p, uint8_t *dest, size_t *dest_len, const uint8_t *src, size_t *src_len,
+                    int src_finished, int finish_mode, int *status) {
+  (void)src_finished;
+  (void)finish_mode;
+  xz_shim_state_t *state = (xz_shim_state_t *)p;
+  if (state->end_pending) {
+    *src_len = 0;
+    *dest_len = 0;
+    state->end_pending = false;
+    state->finished = true;
+    *status = CODER_STATUS_FINISHED_WITH_MARK;
+    return SZ_OK;
+  }
+  if (NULL == state->stream) return SZ_ERROR_DATA;
+  lzma_stream *stream = state->stream;
+  stream->next_in = src;
+  stream->avail_in = *src_len;
+  stream->next_out = dest;
+  stream->avail_out = *dest_len;
+  lzma_ret ret = lzma_code(stream, LZMA_RUN);
+  *src_len -= stream->avail_in;
+  *dest_len -= stream->avail_out;
+  if (LZMA_STREAM_END == ret) {
+    // the LZMA SDK stops as soon as the output is full, and only reads the rest of the stream on
+    // the next call
+    if (0 == stream->avail_out) {
+      state->end_pending = true;
+      *status = CODER_STATUS_NOT_FINISHED;
+      return SZ_OK;
+    }
+    state->finished = true;
+    *status = CODER_STATUS_FINISHED_WITH_MARK;
+    return SZ_OK;
+  }
+  if (LZMA_OK != ret) return SZ_ERROR_DATA;
+  *status = 0 == stream->avail_in && 0 != stream->avail_out ? CODER_STATUS_NEEDS_MORE_INPUT
+                                                            : CODER_STATUS_NOT_FINISHED;
+  return SZ_OK;
+}
+
+int XzUnpacker_IsStreamWasFinished(const void *p) {
+  return ((const xz_shim_state_t *)p)->finished;
+}
+
+void XzUnpacker_Free(void *p) {
+  xz_shim_state_t *state = (xz_shim_state_t *)p;
+  if (NULL == state->stream) return;
+  lzma_end(state->stream);
+  free(state->stream);
+  state->stream = NULL;
+}
@@ -0,0 +1,755 @@
+#include "xdl_bench.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <map>
+#include <random>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "dump_stats.h"
+#include "xdl.h"
+#include "xdl/xdl_lzma.h"
+
+// the bench links with --wrap=realloc, so the buffer growth of xdl_lzma_decompress() can be counted
+static std::atomic<size_t> realloc_calls{0};
+
+extern "C" void *__real_realloc(void *ptr, size_t size);
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size) {
+    realloc_calls.fetch_add(1, std::memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+
+static std::string read_file(const char *path) {
+    std::string content;
+    if (auto file = fopen(path, "rb")) {
+        char buffer[65536];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            content.append(buffer, n);
+        }
+        fclose(file);
+    }
+    return content;
+}
+
+// defined symbols of the first section of `type` in `path`
+static std::vector<ElfSymbol> read_elf_symbols(const char *path, uint32_t type) {
+    std::vector<ElfSymbol> symbols;
+    auto fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return symbols;
+    }
+    struct stat st{};
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(Elf64_Ehdr)) {
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        return symbols;
+    }
+    auto file = static_cast<const char *>(map);
+    auto size = (size_t) st.st_size;
+    auto ehdr = reinterpret_cast<const Elf64_Ehdr *>(file);
+    auto in_file = [size](uint64_t offset, uint64_t length) {
+        return offset <= size && length <= size - offset;
+    };
+    if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) == 0 && ehdr->e_ident[EI_CLASS] == ELFCLASS64 &&
+        ehdr->e_shentsize == sizeof(Elf64_Shdr) && in_file(ehdr->e_shoff, ehdr->e_shnum * sizeof(Elf64_Shdr))) {
+        auto shdrs = reinterpret_cast<const Elf64_Shdr *>(file + ehdr->e_shoff);
+        for (int i = 0; i < ehdr->e_shnum; ++i) {
+            auto &symtab = shdrs[i];
+            if (symtab.sh_type != type || symtab.sh_link >= ehdr->e_shnum) {
+                continue;
+            }
+            auto &strtab = shdrs[symtab.sh_link];
+            if (!in_file(symtab.sh_offset, symtab.sh_size) || !in_file(strtab.sh_offset, strtab.sh_size)) {
+                break;
+            }
+            auto syms = reinterpret_cast<const Elf64_Sym *>(file + symtab.sh_offset);
+            auto strings = file + strtab.sh_offset;
+            for (size_t j = 0; j < symtab.sh_size / sizeof(Elf64_Sym); ++j) {
+                auto &sym = syms[j];
+                // what xdl considers exported from .dynsym and .symtab
+                if (sym.st_shndx == SHN_UNDEF || sym.st_shndx >= SHN_LORESERVE ||
+                    sym.st_name == 0 || sym.st_name >= strtab.sh_size) {
+                    continue;
+                }
+                symbols.push_back({strings + sym.st_name, sym.st_value, sym.st_size, ELF64_ST_TYPE(sym.st_info)});
+            }
+            break;
+        }
+    }
+    munmap(map, size);
+    return symbols;
+}
+
+std::vector<ElfSymbol> read_elf_symtab(const char *path) {
+    return read_elf_symbols(path, SHT_SYMTAB);
+}
+
+int run_symtab_bench(const char *soname) {
+    auto handle = xdl_open(soname, XDL_DEFAULT);
+    if (!handle) {
+        fprintf(stderr, "xdl_open %s failed\n", soname);
+        return 1;
+    }
+    xdl_info_t info{};
+    xdl_info(handle, XDL_DI_DLINFO, &info);
+    auto symbols = read_elf_symtab(info.dli_fname);
+    if (symbols.empty()) {
+        fprintf(stderr, "%s has no .symtab\n", info.dli_fname);
+        xdl_close(handle);
+        return 1;
+    }
+
+    // the first lookup loads .symtab and builds the index
+    auto begin = monotonic_ns();
+    xdl_dsym(handle, symbols[0].name.c_str(), nullptr);
+    auto load_ns = monotonic_ns() - begin;
+    xdl_symtab_index_info_t index{};
+    if (xdl_info(handle, XDL_DI_SYMTAB_INDEX, &index) != 0) {
+        fprintf(stderr, "xdl could not load the .symtab of %s\n", info.dli_fname);
+        xdl_close(handle);
+        return 1;
+    }
+    printf("%s: %zu .symtab entries, %zu names indexed\n", info.dli_fname, index.symtab_cnt, index.indexed_cnt);
+    printf("index: %.1f KB, built in %.3f ms; first xdl_dsym (load + index) %.3f ms\n",
+           (double) index.index_sz / 1024.0, (double) index.build_ns / 1e6, (double) load_ns / 1e6);
+
+    size_t missing = 0;
+    begin = monotonic_ns();
+    for (auto &symbol: symbols) {
+        if (!xdl_dsym(handle, symbol.name.c_str(), nullptr)) {
+            ++missing;
+        }
+    }
+    auto indexed_ns = monotonic_ns() - begin;
+    printf("xdl_dsym: %zu lookups, %.1f ns/lookup, %zu missing\n", symbols.size(),
+           (double) indexed_ns / (double) symbols.size(), missing);
+
+    // what every lookup cost before the index: a strcmp over .symtab until the name matches
+    auto samples = std::min<size_t>(symbols.size(), 2000);
+    auto stride = symbols.size() / samples;
+    size_t found = 0;
+    begin = monotonic_ns();
+    for (size_t i = 0; i < samples; ++i) {
+        auto name = symbols[i * stride].name.c_str();
+        for (auto &symbol: symbols) {
+            if (strcmp(symbol.name.c_str(), name) == 0) {
+                ++found;
+                break;
+            }
+        }
+    }
+    auto scan_ns = monotonic_ns() - begin;
+    printf("linear scan: %zu lookups, %.1f ns/lookup\n", found, (double) scan_ns / (double) samples);
+    xdl_close(handle);
+    return missing == 0 ? 0 : 1;
+}
+
+// every info must name a symbol that contains its address
+static size_t count_unresolved(const std::vector<void *> &addrs, const std::vector<xdl_info_t> &infos) {
+    size_t unresolved = 0;
+    for (size_t i = 0; i < addrs.size(); ++i) {
+        auto addr = (uintptr_t) addrs[i];
+        auto saddr = (uintptr_t) infos[i].dli_saddr;
+        if (!infos[i].dli_sname || addr < saddr || addr >= saddr + infos[i].dli_ssize) {
+            ++unresolved;
+        }
+    }
+    return unresolved;
+}
+
+int run_addr_bench(const char *soname) {
+    auto handle = xdl_open(soname, XDL_DEFAULT);
+    if (!handle) {
+        fprintf(stderr, "xdl_open %s failed\n", soname);
+        return 1;
+    }
+    xdl_info_t info{};
+    xdl_info(handle, XDL_DI_DLINFO, &info);
+    auto base = (uintptr_t) info.dli_fbase;
+    std::string path = info.dli_fname;
+    xdl_close(handle);
+
+    std::vector<ElfSymbol> functions;
+    for (auto &symbol: read_elf_symtab(path.c_str())) {
+        if (symbol.size > 0 && symbol.type != STT_TLS) {
+            functions.push_back(std::move(symbol));
+        }
+    }
+    if (functions.empty()) {
+        fprintf(stderr, "%s has no sized .symtab symbols\n", path.c_str());
+        return 1;
+    }
+    // what xdl_addr() has to report for aliases: the name that comes first in .dynsym, else in .symtab
+    auto dynsym = read_elf_symbols(path.c_str(), SHT_DYNSYM);
+    std::map<std::pair<uint64_t, uint64_t>, const char *> first_names;
+    for (auto table: {&dynsym, &functions}) {
+        for (auto &symbol: *table) {
+            first_names.emplace(std::make_pair(symbol.value, symbol.size), symbol.name.c_str());
+        }
+    }
+    // a pc somewhere inside each function, in random order like a sampling profile
+    std::vector<void *> addrs;
+    std::mt19937_64 random(1);
+    for (auto &function: functions) {
+        addrs.push_back((void *) (base + function.value + random() % function.size));
+    }
+    std::shuffle(addrs.begin(), addrs.end(), random);
+    auto count_not_first = [&](const std::vector<xdl_info_t> &results) {
+        size_t not_first = 0;
+        for (auto &result: results) {
+            auto first = result.dli_sname ? first_names.find(
+                    {(uintptr_t) result.dli_saddr - base, result.dli_ssize}) : first_names.end();
+            not_first += first != first_names.end() && strcmp(first->second, result.dli_sname) != 0;
+        }
+        return not_first;
+    };
+    std::vector<xdl_info_t> infos(addrs.size());
+    printf("%s: %zu addresses\n", path.c_str(), addrs.size());
+
+    // the first call opens the handle, loads both symbol tables and builds their address indexes
+    void *cache = nullptr;
+    auto begin = monotonic_ns();
+    xdl_addr(addrs[0], &infos[0], &cache);
+    auto first_ns = monotonic_ns() - begin;
+    begin = monotonic_ns();
+    for (size_t i = 0; i < addrs.size(); ++i) {
+        xdl_addr(addrs[i], &infos[i], &cache);
+    }
+    auto single_ns = monotonic_ns() - begin;
+    printf("first xdl_addr (load + index) %.3f ms\n", (double) first_ns / 1e6);
+    printf("xdl_addr: %.1f ns/address, %zu unresolved\n", (double) single_ns / (double) addrs.size(),
+           count_unresolved(addrs, infos));
+    auto failures = count_not_first(infos);
+
+    std::sort(addrs.begin(), addrs.end());
+    begin = monotonic_ns();
+    auto resolved = xdl_addr_batch(addrs.data(), infos.data(), addrs.size(), &cache);
+    auto batch_ns = monotonic_ns() - begin;
+    printf("xdl_addr_batch (sorted): %.1f ns/address, %zu/%zu libraries found, %zu unresolved\n",
+           (double) batch_ns / (double) addrs.size(), resolved, addrs.size(), count_unresolved(addrs, infos));
+    failures += count_not_first(infos);
+    if (failures > 0) {
+        fprintf(stderr, "%zu addresses resolved to an alias that is not the first one in its symbol table\n", failures);
+    }
+
+    // one address in every loaded segment, so lookups go through the handle cache of many libraries
+    std::vector<void *> segment_addrs;
+    xdl_iterate_phdr(
+            [](dl_phdr_info *info, size_t, void *arg) {
+                auto addrs = static_cast<std::vector<void *> *>(arg);
+                for (int i = 0; i < info->dlpi_phnum; ++i) {
+                    auto &phdr = info->dlpi_phdr[i];
+                    if (phdr.p_type == PT_LOAD && phdr.p_memsz > 0 && info->dlpi_addr + phdr.p_vaddr != 0) {
+                        addrs->push_back((void *) (info->dlpi_addr + phdr.p_vaddr + phdr.p_memsz / 2));
+                    }
+                }
+                return 0;
+            }, &segment_addrs, XDL_DEFAULT);
+    std::shuffle(segment_addrs.begin(), segment_addrs.end(), random);
+    size_t libraries_found = 0;
+    for (auto addr: segment_addrs) {
+        libraries_found += xdl_addr(addr, &info, &cache);
+    }
+    constexpr int kRounds = 1000;
+    begin = monotonic_ns();
+    for (int round = 0; round < kRounds; ++round) {
+        for (auto addr: segment_addrs) {
+            xdl_addr(addr, &info, &cache);
+        }
+    }
+    auto cached_ns = monotonic_ns() - begin;
+    printf("handle cache: %zu segments, %zu found, %.1f ns/address\n", segment_addrs.size(), libraries_found,
+           (double) cached_ns / (double) (segment_addrs.size() * kRounds));
+    xdl_addr_clean(&cache);
+
+    // what every address cost before the index: a scan of the whole table
+    auto samples = std::min<size_t>(addrs.size(), 2000);
+    size_t found = 0;
+    begin = monotonic_ns();
+    for (size_t i = 0; i < samples; ++i) {
+        auto offset = (uintptr_t) addrs[i * (addrs.size() / samples)] - base;
+        for (auto &function: functions) {
+            if (offset >= function.value && offset < function.value + function.size) {
+                ++found;
+                break;
+            }
+        }
+    }
+    auto scan_ns = monotonic_ns() - begin;
+    printf("linear scan: %zu addresses, %.1f ns/address\n", found, (double) scan_ns / (double) samples);
+    return count_unresolved(addrs, infos) == 0 && failures == 0 ? 0 : 1;
+}
+
+int run_open_bench(const char *soname) {
+    // the first lookup builds the snapshot of loaded libraries
+    auto begin = monotonic_ns();
+    auto handle = xdl_open(soname, XDL_DEFAULT);
+    auto first_ns = monotonic_ns() - begin;
+    if (!handle) {
+        fprintf(stderr, "xdl_open %s failed\n", soname);
+        return 1;
+    }
+    xdl_close(handle);
+    size_t libraries = 0;
+    xdl_iterate_phdr([](dl_phdr_info *, size_t, void *arg) {
+        ++*static_cast<size_t *>(arg);
+        return 0;
+    }, &libraries, XDL_DEFAULT);
+    printf("%zu libraries loaded, first xdl_open %.1f us\n", libraries, (double) first_ns / 1e3);
+
+    constexpr int kRounds = 20000;
+    size_t failures = 0;
+    begin = monotonic_ns();
+    for (int i = 0; i < kRounds; ++i) {
+        handle = xdl_open(soname, XDL_DEFAULT);
+        failures += handle == nullptr;
+        xdl_close(handle);
+    }
+    auto open_ns = monotonic_ns() - begin;
+    begin = monotonic_ns();
+    for (int i = 0; i < kRounds; ++i) {
+        failures += xdl_open("libnot_loaded.so", XDL_DEFAULT) != nullptr;
+    }
+    auto miss_ns = monotonic_ns() - begin;
+
+    // what each of them cost before the snapshot: a walk until the library matches
+    struct Walk {
+        const char *soname;
+        bool found;
+    } walk{soname, false};
+    begin = monotonic_ns();
+    for (int i = 0; i < kRounds; ++i) {
+        walk.found = false;
+        xdl_iterate_phdr([](dl_phdr_info *info, size_t, void *arg) {
+            auto walk = static_cast<Walk *>(arg);
+            auto length = strlen(info->dlpi_name);
+            auto soname_length = strlen(walk->soname);
+            walk->found = length >= soname_length &&
+                          strcmp(info->dlpi_name + length - soname_length, walk->soname) == 0;
+            return walk->found ? 1 : 0;
+        }, &walk, XDL_DEFAULT);
+        failures += !walk.found;
+    }
+    auto walk_ns = monotonic_ns() - begin;
+    printf("xdl_open: %.1f ns, missing library %.1f ns; walk to the library %.1f ns\n",
+           (double) open_ns / kRounds, (double) miss_ns / kRounds, (double) walk_ns / kRounds);
+
+    // every loaded library by basename, one xdl_open() each or all with one xdl_open_many()
+    std::vector<std::string> pathnames;
+    xdl_iterate_phdr([](dl_phdr_info *info, size_t, void *arg) {
+        if (strrchr(info->dlpi_name, '/')) {
+            static_cast<std::vector<std::string> *>(arg)->push_back(info->dlpi_name);
+        }
+        return 0;
+    }, &pathnames, XDL_DEFAULT);
+    std::vector<std::string> basenames;
+    for (auto &pathname: pathnames) {
+        basenames.push_back(pathname.substr(pathname.rfind('/') + 1));
+    }
+    std::vector<const char *> names;
+    for (auto &basename: basenames) {
+        names.push_back(basename.c_str());
+    }
+    std::vector<void *> handles(names.size());
+    constexpr int kManyRounds = 2000;
+    begin = monotonic_ns();
+    for (int i = 0; i < kManyRounds; ++i) {
+        for (size_t j = 0; j < names.size(); ++j) {
+            handles[j] = xdl_open(names[j], XDL_DEFAULT);
+            failures += handles[j] == nullptr;
+            xdl_close(handles[j]);
+        }
+    }
+    auto each_ns = monotonic_ns() - begin;
+    begin = monotonic_ns();
+    for (int i = 0; i < kManyRounds; ++i) {
+        failures += names.size() - xdl_open_many(names.data(), names.size(), XDL_DEFAULT, handles.data());
+        for (auto handle: handles) {
+            xdl_close(handle);
+        }
+    }
+    auto many_ns = monotonic_ns() - begin;
+    printf("%zu libraries: xdl_open each %.1f us, xdl_open_many %.1f us\n", names.size(),
+           (double) each_ns / kManyRounds / 1e3, (double) many_ns / kManyRounds / 1e3);
+
+    // both match names the same way, also trailing parts of a path and parts of a basename, which
+    // neither finds
+    std::vector<std::string> suffixes;
+    for (auto &pathname: pathnames) {
+        auto slash = pathname.rfind('/');
+        auto parent = slash > 0 ? pathname.rfind('/', slash - 1) : std::string::npos;
+        suffixes.push_back(parent == std::string::npos ? pathname : pathname.substr(parent + 1));
+        suffixes.push_back(pathname.substr(slash + 2));
+    }
+    names.clear();
+    for (auto &suffix: suffixes) {
+        names.push_back(suffix.c_str());
+    }
+    handles.resize(names.size());
+    xdl_open_many(names.data(), names.size(), XDL_DEFAULT, handles.data());
+    for (size_t j = 0; j < names.size(); ++j) {
+        auto handle = xdl_open(names[j], XDL_DEFAULT);
+        if ((handle == nullptr) != (handles[j] == nullptr)) {
+            fprintf(stderr, "%s: xdl_open %s, xdl_open_many %s\n", names[j], handle ? "found" : "missed",
+                    handles[j] ? "found" : "missed");
+            ++failures;
+        }
+        xdl_close(handle);
+        xdl_close(handles[j]);
+    }
+    if (failures > 0) {
+        fprintf(stderr, "%zu lookups went wrong\n", failures);
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+int run_symbols_bench() {
+    std::vector<std::string> paths;
+    xdl_iterate_phdr([](dl_phdr_info *info, size_t, void *arg) {
+        if (info->dlpi_name[0] == '/') {
+            static_cast<std::vector<std::string> *>(arg)->push_back(info->dlpi_name);
+        }
+        return 0;
+    }, &paths, XDL_DEFAULT);
+
+    struct Count {
+        size_t symbols[3];
+        uint64_t checksum;
+    };
+    auto count = [](const xdl_symbol_t *symbol, void *arg) {
+        auto count = static_cast<Count *>(arg);
+        ++count->symbols[symbol->table];
+        count->checksum += (uintptr_t) symbol->addr + symbol->size + (unsigned char) symbol->name[0];
+        return 0;
+    };
+    size_t failures = 0;
+    for (auto &path: paths) {
+        auto handle = xdl_open(path.c_str(), XDL_DEFAULT);
+        if (!handle) {
+            ++failures;
+            continue;
+        }
+        // the first pass loads the tables
+        Count first{};
+        auto begin = monotonic_ns();
+        xdl_iterate_symbols(handle, XDL_ITERATE_DYNSYM | XDL_ITERATE_SYMTAB, count, &first);
+        auto load_ns = monotonic_ns() - begin;
+        auto symbols = first.symbols[XDL_ITERATE_DYNSYM] + first.symbols[XDL_ITERATE_SYMTAB];
+        if (symbols == 0) {
+            xdl_close(handle);
+            continue;
+        }
+        auto rounds = std::max<size_t>(1, 2000000 / symbols);
+        begin = monotonic_ns();
+        for (size_t i = 0; i < rounds; ++i) {
+            Count again{};
+            xdl_iterate_symbols(handle, XDL_ITERATE_DYNSYM | XDL_ITERATE_SYMTAB, count, &again);
+            failures += again.checksum != first.checksum;
+        }
+        auto iterate_ns = (double) (monotonic_ns() - begin) / (double) rounds;
+
+        // the same map through xdl_addr(), one lookup per function or object
+        std::vector<void *> addrs;
+        xdl_iterate_symbols(handle, XDL_ITERATE_DYNSYM | XDL_ITERATE_SYMTAB, [](const xdl_symbol_t *symbol, void *arg) {
+            if (symbol->size > 0 && (symbol->type == STT_FUNC || symbol->type == STT_OBJECT)) {
+                static_cast<std::vector<void *> *>(arg)->push_back(symbol->addr);
+            }
+            return 0;
+        }, &addrs);
+        void *cache = nullptr;
+        xdl_info_t info{};
+        if (!addrs.empty()) {
+            // loads the tables and builds the address indexes
+            xdl_addr(addrs[0], &info, &cache);
+        }
+        begin = monotonic_ns();
+        for (auto addr: addrs) {
+            xdl_addr(addr, &info, &cache);
+        }
+        auto addr_ns = monotonic_ns() - begin;
+        xdl_addr_clean(&cache);
+        xdl_close(handle);
+
+        printf("%s: %zu .dynsym + %zu .symtab symbols, first pass %.3f ms, then %.1f ns/symbol (%.0f M/s); "
+               "xdl_addr %.1f ns/symbol\n", path.c_str(), first.symbols[XDL_ITERATE_DYNSYM],
+               first.symbols[XDL_ITERATE_SYMTAB], (double) load_ns / 1e6, iterate_ns / (double) symbols,
+               (double) symbols / iterate_ns * 1e3, addrs.empty() ? 0.0 : (double) addr_ns / (double) addrs.size());
+    }
+    if (failures > 0) {
+        fprintf(stderr, "%zu libraries went wrong\n", failures);
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+int run_stress_bench(const char *soname, int threads, int rounds) {
+    auto handle = xdl_open(soname, XDL_DEFAULT);
+    if (!handle) {
+        fprintf(stderr, "xdl_open %s failed\n", soname);
+        return 1;
+    }
+    xdl_info_t info{};
+    xdl_info(handle, XDL_DI_DLINFO, &info);
+    std::vector<std::string> names;
+    for (auto &symbol: read_elf_symtab(info.dli_fname)) {
+        names.push_back(std::move(symbol.name));
+    }
+    if (names.empty()) {
+        fprintf(stderr, "%s has no .symtab\n", info.dli_fname);
+        xdl_close(handle);
+        return 1;
+    }
+    std::vector<const char *> name_ptrs;
+    for (auto &name: names) {
+        name_ptrs.push_back(name.c_str());
+    }
+    // what one thread alone gets
+    std::vector<void *> expected_sym(names.size());
+    std::vector<void *> expected_dsym(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        expected_sym[i] = xdl_sym(handle, name_ptrs[i], nullptr);
+        expected_dsym[i] = xdl_dsym(handle, name_ptrs[i], nullptr);
+    }
+    std::string path = info.dli_fname;
+    xdl_close(handle);
+    printf("%s: %zu names, %d threads, %d rounds\n", path.c_str(), names.size(), threads, rounds);
+
+    std::atomic<size_t> mismatches{0};
+    uint64_t first_ns = 0;
+    uint64_t total_ns = 0;
+    for (int round = 0; round < rounds; ++round) {
+        auto shared = xdl_open(soname, XDL_DEFAULT);
+        if (!shared) {
+            fprintf(stderr, "xdl_open %s failed\n", soname);
+            return 1;
+        }
+        std::atomic<int> waiting{threads};
+        std::atomic<uint64_t> round_first_ns{0};
+        std::vector<std::thread> workers;
+        auto begin = monotonic_ns();
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                // start together so the first lookups race the lazy loads
+                waiting.fetch_sub(1);
+                while (waiting.load() > 0) {
+                    std::this_thread::yield();
+                }
+                auto start = monotonic_ns();
+                size_t bad = 0;
+                // each thread starts at a different name and alternates the table it uses first
+                auto offset = names.size() * t / threads;
+                for (size_t n = 0; n < names.size(); ++n) {
+                    auto i = (offset + n) % names.size();
+                    if ((t & 1) == 0) {
+                        bad += xdl_dsym(shared, name_ptrs[i], nullptr) != expected_dsym[i];
+                        bad += xdl_sym(shared, name_ptrs[i], nullptr) != expected_sym[i];
+                    } else {
+                        bad += xdl_sym(shared, name_ptrs[i], nullptr) != expected_sym[i];
+                        bad += xdl_dsym(shared, name_ptrs[i], nullptr) != expected_dsym[i];
+                    }
+                    if (n == 0) {
+                        auto ns = monotonic_ns() - start;
+                        auto seen = round_first_ns.load();
+                        while (ns > seen && !round_first_ns.compare_exchange_weak(seen, ns)) {
+                        }
+                    }
+                }
+                std::vector<void *> addrs(names.size());
+                xdl_sym_batch(shared, name_ptrs.data(), name_ptrs.size(), addrs.data(), nullptr, nullptr);
+                for (size_t i = 0; i < names.size(); ++i) {
+                    bad += addrs[i] != expected_sym[i];
+                }
+                mismatches.fetch_add(bad);
+            });
+        }
+        for (auto &worker: workers) {
+            worker.join();
+        }
+        total_ns += monotonic_ns() - begin;
+        first_ns += round_first_ns.load();
+        xdl_close(shared);
+    }
+    auto lookups = (double) rounds * (double) threads * (double) names.size() * 3;
+    printf("slowest first lookup (load + index) %.3f ms on average\n", (double) first_ns / (double) rounds / 1e6);
+    printf("%.0f lookups in %.3f ms, %.1f ns/lookup across threads, %zu mismatches\n", lookups,
+           (double) total_ns / 1e6, (double) total_ns / lookups, mismatches.load());
+    return mismatches.load() == 0 ? 0 : 1;
+}
+
+struct CachedSymbol {
+    std::string name;
+    void *addr;
+    size_t size;
+};
+
+// .symtab of `handle` as xdl_iterate_symbols() reports it, loading the table on first use
+static std::vector<CachedSymbol> collect_symtab(void *handle, uint64_t &load_ns, const char *&first_name) {
+    std::vector<CachedSymbol> symbols;
+    first_name = nullptr;
+    struct Collect {
+        std::vector<CachedSymbol> *symbols;
+        const char **first_name;
+    } collect{&symbols, &first_name};
+    auto begin = monotonic_ns();
+    xdl_iterate_symbols(handle, XDL_ITERATE_SYMTAB, [](const xdl_symbol_t *symbol, void *arg) {
+        auto collect = static_cast<Collect *>(arg);
+        if (!*collect->first_name) {
+            *collect->first_name = symbol->name;
+        }
+        collect->symbols->push_back({symbol->name, symbol->addr, symbol->size});
+        return 0;
+    }, &collect);
+    load_ns = monotonic_ns() - begin;
+    return symbols;
+}
+
+// whether `addr` lies in a mapping of `path`, per /proc/self/maps
+static bool is_mapped_from(const void *addr, const std::string &path) {
+    auto fp = fopen("/proc/self/maps", "re");
+    if (!fp) {
+        return false;
+    }
+    auto found = false;
+    char line[4096];
+    while (!found && fgets(line, sizeof(line), fp)) {
+        uintptr_t start;
+        uintptr_t end;
+        int offset = 0;
+        if (sscanf(line, "%" SCNxPTR "-%" SCNxPTR " %*s %*s %*s %*s %n", &start, &end, &offset) < 2 || !offset) {
+            continue;
+        }
+        std::string mapped(line + offset);
+        while (!mapped.empty() && mapped.back() == '\n') {
+            mapped.pop_back();
+        }
+        found = mapped == path && (uintptr_t) addr >= start && (uintptr_t) addr < end;
+    }
+    fclose(fp);
+    return found;
+}
+
+// decompresses `xz_path` with xdl_lzma_decompress() through the XzUnpacker of XDL_LZMA_PATHNAME,
+// which must fill the buffer sized from the XZ index in one allocation, without growing it
+static bool check_lzma_decompress(const char *xz_path, const char *expected_path) {
+    auto compressed = read_file(xz_path);
+    auto expected = read_file(expected_path);
+    if (compressed.empty() || expected.empty()) {
+        fprintf(stderr, "cannot read %s or %s\n", xz_path, expected_path);
+        return false;
+    }
+    uint8_t *dst = nullptr;
+    size_t dst_size = 0;
+    // the first call also finds the decoder with xdl_open(), whose reallocs do not count
+    if (xdl_lzma_decompress(reinterpret_cast<uint8_t *>(compressed.data()), compressed.size(), &dst, &dst_size) == 0) {
+        free(dst);
+        dst = nullptr;
+    }
+    auto reallocs = realloc_calls.load();
+    auto r = xdl_lzma_decompress(reinterpret_cast<uint8_t *>(compressed.data()), compressed.size(), &dst, &dst_size);
+    reallocs = realloc_calls.load() - reallocs;
+    auto ok = r == 0 && dst_size == expected.size() && memcmp(dst, expected.data(), dst_size) == 0;
+    if (!ok) {
+        fprintf(stderr, "%s: xdl_lzma_decompress returned %d and %zu bytes, %zu expected\n", xz_path, r, dst_size,
+                expected.size());
+    } else if (reallocs != 1) {
+        fprintf(stderr, "%s: %zu bytes took %zu allocations, not one\n", xz_path, dst_size, reallocs);
+        ok = false;
+    }
+    free(dst);
+    return ok;
+}
+
+int run_symtab_cache_bench(const char *path, const char *debug_path) {
+    if (!check_lzma_decompress((std::string(debug_path) + ".xz").c_str(), debug_path)) {
+        return 1;
+    }
+    char dir[] = "/tmp/xdl-symtab-XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "mkdtemp failed: %s\n", strerror(errno));
+        return 1;
+    }
+    xdl_set_symtab_cache_dir(dir);
+    auto library = dlopen(path, RTLD_NOW);
+    if (!library) {
+        fprintf(stderr, "dlopen %s failed: %s\n", path, dlerror());
+        return 1;
+    }
+    auto failures = 0;
+
+    // the first handle decompresses .gnu_debugdata and writes the cache file
+    auto handle = xdl_open(path, XDL_DEFAULT);
+    uint64_t extract_ns = 0;
+    const char *name = nullptr;
+    auto extracted = collect_symtab(handle, extract_ns, name);
+    xdl_close(handle);
+    std::string cache_path;
+    if (auto cache_dir = opendir(dir)) {
+        while (auto entry = readdir(cache_dir)) {
+            if (strstr(entry->d_name, ".symtab")) {
+                cache_path = std::string(dir) + "/" + entry->d_name;
+            }
+        }
+        closedir(cache_dir);
+    }
+    if (extracted.empty() || cache_path.empty()) {
+        fprintf(stderr, "%s: %zu symbols extracted, %s\n", path, extracted.size(),
+                cache_path.empty() ? "no cache file written" : "cache file written");
+        ++failures;
+    }
+
+    // a fresh handle, like the next launch, has to map the cache file instead
+    handle = xdl_open(path, XDL_DEFAULT);
+    uint64_t cached_ns = 0;
+    auto cached = collect_symtab(handle, cached_ns, name);
+    if (!cache_path.empty() && !(name && is_mapped_from(name, cache_path))) {
+        fprintf(stderr, "%s: second load did not come from %s\n", path, cache_path.c_str());
+        ++failures;
+    }
+    auto same = cached.size() == extracted.size();
+    for (size_t i = 0; same && i < cached.size(); ++i) {
+        same = cached[i].name == extracted[i].name && cached[i].addr == extracted[i].addr &&
+               cached[i].size == extracted[i].size;
+    }
+    if (!same) {
+        fprintf(stderr, "%s: %zu symbols from the cache differ from the %zu extracted\n", path, cached.size(),
+                extracted.size());
+        ++failures;
+    }
+    // every function of the unstripped .symtab resolves through the cached table
+    size_t missing = 0;
+    auto expected = read_elf_symtab(debug_path);
+    for (auto &symbol: expected) {
+        if (symbol.type == STT_FUNC && !xdl_dsym(handle, symbol.name.c_str(), nullptr)) {
+            ++missing;
+        }
+    }
+    if (expected.empty() || missing) {
+        fprintf(stderr, "%s: %zu of %zu .symtab functions not found\n", debug_path, missing, expected.size());
+        ++failures;
+    }
+    xdl_close(handle);
+    dlclose(library);
+
+    printf("%s: %zu .symtab symbols, extracted from .gnu_debugdata in %.3f ms, mapped from the cache in %.3f ms "
+           "(%.1fx)\n", path, extracted.size(), (double) extract_ns / 1e6, (double) cached_ns / 1e6,
+           cached_ns ? (double) extract_ns / (double) cached_ns : 0.0);
+    if (!cache_path.empty()) {
+        unlink(cache_path.c_str());
+    }
+    rmdir(dir);
+    xdl_set_symtab_cache_dir(nullptr);
+    return failures == 0 ? 0 : 1;
+}
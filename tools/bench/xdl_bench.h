@@ -0,0 +1,46 @@
+#ifndef ZYGISK_IL2CPPDUMPER_XDL_BENCH_H
+#define ZYGISK_IL2CPPDUMPER_XDL_BENCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// a .symtab entry as read straight from the ELF file, independent of xdl
+struct ElfSymbol {
+    std::string name;
+    uint64_t value;
+    uint64_t size;
+    unsigned char type;
+};
+
+// defined symbols of the .symtab of `path`, empty when it has none
+std::vector<ElfSymbol> read_elf_symtab(const char *path);
+
+// times xdl_dsym() over every .symtab name of the already loaded `soname`
+int run_symtab_bench(const char *soname);
+
+// times xdl_addr() and xdl_addr_batch() over addresses inside the .symtab functions of `soname`
+int run_addr_bench(const char *soname);
+
+// times xdl_open() of `soname` and of a library that is not loaded against walking
+// dl_iterate_phdr() for every lookup, and xdl_open_many() of every loaded library, which has to
+// find what xdl_open() finds
+int run_open_bench(const char *soname);
+
+// times xdl_iterate_symbols() over .dynsym and .symtab of every loaded library, against
+// xdl_addr() of every symbol it reports
+int run_symbols_bench();
+
+// `threads` threads share each of `rounds` fresh handles of `soname` and race their first
+// xdl_sym()/xdl_dsym()/xdl_sym_batch() calls; every result is checked against a handle used
+// by one thread only
+int run_stress_bench(const char *soname, int threads, int rounds);
+
+// loads .symtab of `path`, a library carrying it in .gnu_debugdata, twice with
+// xdl_set_symtab_cache_dir(): the first handle decompresses and writes the cache, the second must
+// map the cache file and report the same symbols, which are checked against the unstripped
+// .symtab in `debug_path`. First decompresses `debug_path`.xz on its own, which has to take a single
+// allocation of the size the XZ index names
+int run_symtab_cache_bench(const char *path, const char *debug_path);
+
+#endif //ZYGISK_IL2CPPDUMPER_XDL_BENCH_H
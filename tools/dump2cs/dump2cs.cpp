@@ -0,0 +1,265 @@
+// Turns files/dump.bin back into the dump.cs text the module writes in text mode.
+//
+//   dump2cs dump.bin [dump.cs]
+//
+// Without an output path the text goes to stdout.
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "dump_binary.h"
+#include "dump_format.h"
+#include "text_builder.h"
+
+static constexpr size_t kFlushSize = 1 << 20;
+
+struct BinaryDump {
+    const BinaryDumpHeader *header;
+    const char *strings;
+    uint64_t strings_size;
+    const BinaryDumpImage *images;
+    const BinaryDumpType *types;
+    const uint32_t *extends;
+    const BinaryDumpField *fields;
+    const BinaryDumpProperty *properties;
+    const BinaryDumpMethod *methods;
+    const BinaryDumpParam *params;
+
+    uint64_t count(BinaryDumpSectionId id) const {
+        return header->sections[id].count;
+    }
+
+    const char *string(uint32_t id) const {
+        if (id == kBinaryDumpNoString || id >= strings_size) {
+            return nullptr;
+        }
+        return strings + id;
+    }
+};
+
+static bool fail(const char *message) {
+    fprintf(stderr, "dump2cs: %s\n", message);
+    return false;
+}
+
+static bool in_range(uint64_t begin, uint64_t count, uint64_t size) {
+    return begin <= size && count <= size - begin;
+}
+
+static bool map_dump(const void *data, uint64_t size, BinaryDump &dump) {
+    auto base = static_cast<const char *>(data);
+    if (size < sizeof(BinaryDumpHeader)) {
+        return fail("file too small");
+    }
+    auto header = reinterpret_cast<const BinaryDumpHeader *>(base);
+    if (memcmp(header->magic, kBinaryDumpMagic, sizeof(header->magic)) != 0) {
+        return fail("not a binary dump");
+    }
+    if (header->version != kBinaryDumpVersion) {
+        fprintf(stderr, "dump2cs: unsupported version %u\n", header->version);
+        return false;
+    }
+    static constexpr size_t kRecordSize[BINARY_DUMP_SECTION_COUNT] = {
+            1,
+            sizeof(BinaryDumpImage),
+            sizeof(BinaryDumpType),
+            sizeof(uint32_t),
+            sizeof(BinaryDumpField),
+            sizeof(BinaryDumpProperty),
+            sizeof(BinaryDumpMethod),
+            sizeof(BinaryDumpParam),
+    };
+    for (int i = 0; i < BINARY_DUMP_SECTION_COUNT; ++i) {
+        auto &section = header->sections[i];
+        if (section.offset % 8 || section.count > size / kRecordSize[i] ||
+            !in_range(section.offset, section.count * kRecordSize[i], size)) {
+            return fail("section out of bounds");
+        }
+    }
+    auto section = [&](BinaryDumpSectionId id) {
+        return base + header->sections[id].offset;
+    };
+    dump.header = header;
+    dump.strings = section(BINARY_DUMP_STRINGS);
+    dump.strings_size = header->sections[BINARY_DUMP_STRINGS].count;
+    if (dump.strings_size == 0 || dump.strings[dump.strings_size - 1] != '\0') {
+        return fail("unterminated string table");
+    }
+    dump.images = reinterpret_cast<const BinaryDumpImage *>(section(BINARY_DUMP_IMAGES));
+    dump.types = reinterpret_cast<const BinaryDumpType *>(section(BINARY_DUMP_TYPES));
+    dump.extends = reinterpret_cast<const uint32_t *>(section(BINARY_DUMP_EXTENDS));
+    dump.fields = reinterpret_cast<const BinaryDumpField *>(section(BINARY_DUMP_FIELDS));
+    dump.properties = reinterpret_cast<const BinaryDumpProperty *>(section(BINARY_DUMP_PROPERTIES));
+    dump.methods = reinterpret_cast<const BinaryDumpMethod *>(section(BINARY_DUMP_METHODS));
+    dump.params = reinterpret_cast<const BinaryDumpParam *>(section(BINARY_DUMP_PARAMS));
+    return true;
+}
+
+static bool check_type(const BinaryDump &dump, const BinaryDumpType &type) {
+    if (type.image >= dump.count(BINARY_DUMP_IMAGES) ||
+        !in_range(type.extends_begin, type.extends_count, dump.count(BINARY_DUMP_EXTENDS)) ||
+        !in_range(type.field_begin, type.field_count, dump.count(BINARY_DUMP_FIELDS)) ||
+        !in_range(type.property_begin, type.property_count, dump.count(BINARY_DUMP_PROPERTIES)) ||
+        !in_range(type.method_begin, type.method_count, dump.count(BINARY_DUMP_METHODS))) {
+        return false;
+    }
+    for (auto i = type.method_begin; i < type.method_begin + type.method_count; ++i) {
+        auto &method = dump.methods[i];
+        if (!in_range(method.param_begin, method.param_count, dump.count(BINARY_DUMP_PARAMS))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// mirrors dump_type() in il2cpp_dump.cpp
+static void render_type(const BinaryDump &dump, const BinaryDumpType &type, TextBuilder &outPut) {
+    outPut << "\n// Dll : " << dump.string(dump.images[type.image].name);
+    outPut << "\n// Namespace: " << dump.string(type.namespaze) << "\n";
+    if (type.flags & TYPE_ATTRIBUTE_SERIALIZABLE) {
+        outPut << "[Serializable]\n";
+    }
+    dump_type_modifier(outPut, type.flags, type.kind & BINARY_DUMP_TYPE_VALUETYPE,
+                       type.kind & BINARY_DUMP_TYPE_ENUM);
+    outPut << dump.string(type.name);
+    auto extends = " : ";
+    for (auto i = type.extends_begin; i < type.extends_begin + type.extends_count; ++i) {
+        outPut << extends << dump.string(dump.extends[i]);
+        extends = ", ";
+    }
+    outPut << "\n{";
+
+    outPut << "\n\t// Fields\n";
+    for (auto i = type.field_begin; i < type.field_begin + type.field_count; ++i) {
+        auto &field = dump.fields[i];
+        outPut << "\t";
+        dump_field_modifier(outPut, field.flags);
+        outPut << dump.string(field.type) << " " << dump.string(field.name);
+        if (field.bits & BINARY_DUMP_FIELD_HAS_VALUE) {
+            outPut << " = ";
+            outPut.append_dec(field.value);
+        }
+        outPut << "; // 0x";
+        outPut.append_hex(field.offset);
+        outPut << "\n";
+    }
+
+    outPut << "\n\t// Properties\n";
+    for (auto i = type.property_begin; i < type.property_begin + type.property_count; ++i) {
+        auto &property = dump.properties[i];
+        outPut << "\t";
+        if (property.bits & (BINARY_DUMP_PROPERTY_GET | BINARY_DUMP_PROPERTY_SET)) {
+            dump_method_modifier(outPut, property.flags);
+        }
+        if (property.bits & BINARY_DUMP_PROPERTY_UNKNOWN) {
+            if (auto name = dump.string(property.name)) {
+                outPut << " // unknown property " << name;
+            }
+            continue;
+        }
+        outPut << dump.string(property.type) << " " << dump.string(property.name) << " { ";
+        if (property.bits & BINARY_DUMP_PROPERTY_GET) {
+            outPut << "get; ";
+        }
+        if (property.bits & BINARY_DUMP_PROPERTY_SET) {
+            outPut << "set; ";
+        }
+        outPut << "}\n";
+    }
+
+    outPut << "\n\t// Methods\n";
+    for (auto i = type.method_begin; i < type.method_begin + type.method_count; ++i) {
+        auto &method = dump.methods[i];
+        dump_method_address(outPut, method.rva, method.va);
+        outPut << "\n\t";
+        dump_method_modifier(outPut, method.flags);
+        if (method.bits & BINARY_DUMP_BYREF) {
+            outPut << "ref ";
+        }
+        outPut << dump.string(method.return_type) << " " << dump.string(method.name) << "(";
+        for (auto j = method.param_begin; j < method.param_begin + method.param_count; ++j) {
+            auto &param = dump.params[j];
+            dump_param_modifier(outPut, param.attrs, param.bits & BINARY_DUMP_BYREF);
+            outPut << dump.string(param.type) << " " << dump.string(param.name);
+            outPut << ", ";
+        }
+        if (method.param_count > 0) {
+            outPut.unappend(2);
+        }
+        outPut << ") { }\n";
+    }
+    outPut << "}\n";
+}
+
+static bool flush(TextBuilder &outPut, FILE *out) {
+    if (fwrite(outPut.data(), 1, outPut.size(), out) != outPut.size()) {
+        fprintf(stderr, "dump2cs: write failed: %s\n", strerror(errno));
+        return false;
+    }
+    outPut.clear();
+    return true;
+}
+
+static bool convert(const BinaryDump &dump, FILE *out) {
+    TextBuilder outPut(kFlushSize * 2);
+    for (uint64_t i = 0; i < dump.count(BINARY_DUMP_IMAGES); ++i) {
+        dump_image_line(outPut, i, dump.string(dump.images[i].name),
+                        dump.images[i].flags & BINARY_DUMP_IMAGE_SKIPPED);
+    }
+    for (uint64_t i = 0; i < dump.count(BINARY_DUMP_TYPES); ++i) {
+        auto &type = dump.types[i];
+        if (!check_type(dump, type)) {
+            fprintf(stderr, "dump2cs: type %" PRIu64 " is corrupt\n", i);
+            return false;
+        }
+        render_type(dump, type, outPut);
+        if (outPut.size() >= kFlushSize && !flush(outPut, out)) {
+            return false;
+        }
+    }
+    return flush(outPut, out);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s dump.bin [dump.cs]\n", argv[0]);
+        return 2;
+    }
+    auto fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "dump2cs: open %s failed: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "dump2cs: %s is empty\n", argv[1]);
+        close(fd);
+        return 1;
+    }
+    auto data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "dump2cs: mmap failed: %s\n", strerror(errno));
+        return 1;
+    }
+    BinaryDump dump{};
+    if (!map_dump(data, st.st_size, dump)) {
+        return 1;
+    }
+    auto out = argc == 3 ? fopen(argv[2], "we") : stdout;
+    if (!out) {
+        fprintf(stderr, "dump2cs: open %s failed: %s\n", argv[2], strerror(errno));
+        return 1;
+    }
+    auto ok = convert(dump, out);
+    if (fclose(out) != 0) {
+        ok = false;
+    }
+    munmap(data, st.st_size);
+    return ok ? 0 : 1;
+}